@@ -33,10 +33,27 @@ enum class STR
 
 #pragma once
 
+#include "EasyProfileConcurrent.h"
+#include "EasyProfileKeys.h"
+#include "EasyProfileSnapshot.h"
+#include "EasyProfileStats.h"
+#include "EasyProfileStorage.h"
+#include "EasyProfileTrace.h"
+
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
 #include <vector>
 
 #ifndef ASSERT
@@ -54,12 +71,315 @@ enum class STR
 
 namespace easyprofile
 {
+    namespace detail
+    {
+        // Fixed size bitset with fast iteration over set bits.
+        template <size_t N>
+        class Bitset
+        {
+        public:
+            static constexpr size_t WordBits = 64;
+            static constexpr size_t WordsCount = (N + WordBits - 1) / WordBits;
+
+            void set(size_t idx)
+            {
+                m_words[idx / WordBits] |= mask(idx);
+            }
+
+            void reset(size_t idx)
+            {
+                m_words[idx / WordBits] &= ~mask(idx);
+            }
+
+            bool test(size_t idx) const
+            {
+                return (m_words[idx / WordBits] & mask(idx)) != 0u;
+            }
+
+            bool any() const
+            {
+                return any(0, WordsCount);
+            }
+
+            size_t count() const
+            {
+                return count(0, WordsCount);
+            }
+
+            void clear()
+            {
+                m_words.fill(0u);
+            }
+
+            // Same on the words [firstWord, lastWord), the keys of one type when a bitset
+            // holds the keys of all types.
+            bool any(size_t firstWord, size_t lastWord) const
+            {
+                for (auto w = firstWord; w < lastWord; w++)
+                {
+                    if (m_words[w] != 0u)
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            size_t count(size_t firstWord, size_t lastWord) const
+            {
+                size_t result = 0;
+                for (auto w = firstWord; w < lastWord; w++)
+                {
+                    result += static_cast<size_t>(std::popcount(m_words[w]));
+                }
+                return result;
+            }
+
+            void clear(size_t firstWord, size_t lastWord)
+            {
+                std::fill(m_words.begin() + static_cast<std::ptrdiff_t>(firstWord),
+                          m_words.begin() + static_cast<std::ptrdiff_t>(lastWord), 0u);
+            }
+
+            Bitset& operator|=(const Bitset& other)
+            {
+                for (size_t w = 0; w < WordsCount; w++)
+                {
+                    m_words[w] |= other.m_words[w];
+                }
+                return *this;
+            }
+
+            uint64_t word(size_t idx) const
+            {
+                return m_words[idx];
+            }
+
+            // Calls func(index) for every set bit in ascending order.
+            template <typename Func>
+            void forEach(Func&& func) const
+            {
+                forEach(0, WordsCount, std::forward<Func>(func));
+            }
+
+            // Same on the words [firstWord, lastWord), index counts from the first of them.
+            template <typename Func>
+            void forEach(size_t firstWord, size_t lastWord, Func&& func) const
+            {
+                for (auto w = firstWord; w < lastWord; w++)
+                {
+                    auto word = m_words[w];
+                    while (word != 0u)
+                    {
+                        auto bitIdx = static_cast<size_t>(std::countr_zero(word));
+                        func((w - firstWord) * WordBits + bitIdx);
+                        word &= word - 1u;
+                    }
+                }
+            }
+
+        private:
+            static constexpr uint64_t mask(size_t idx)
+            {
+                return uint64_t{ 1u } << (idx % WordBits);
+            }
+
+        private:
+            std::array<uint64_t, WordsCount> m_words{};
+        };
+
+        template <typename Enum, typename Value, typename Class>
+        Class declaringClass(void (Class::*)(Enum, Value));
+
+        template <typename Keys, typename Class>
+        Class declaringBatchClass(void (Class::*)(Keys));
+
+        // True if Derived (or a class between it and Base) declares onProfile(Enum, Value).
+        template <typename Derived, typename Base, typename Enum, typename Value>
+        constexpr bool overridesOnProfile()
+        {
+            if constexpr (requires { declaringClass<Enum, Value>(&Derived::onProfile); })
+            {
+                return !std::is_same_v<decltype(declaringClass<Enum, Value>(&Derived::onProfile)), Base>;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        template <typename Derived, typename Base, typename Keys>
+        constexpr bool overridesOnProfileBatch()
+        {
+            if constexpr (requires { declaringBatchClass<Keys>(&Derived::onProfileBatch); })
+            {
+                return !std::is_same_v<decltype(declaringBatchClass<Keys>(&Derived::onProfileBatch)), Base>;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        // Start of each of a run of ranges of the given sizes, every range rounded up to a
+        // multiple of align. The last element is the total.
+        template <size_t N>
+        constexpr std::array<size_t, N + 1> rangeStarts(const std::array<size_t, N>& sizes, size_t align = 1)
+        {
+            std::array<size_t, N + 1> starts{};
+            for (size_t i = 0; i < N; i++)
+            {
+                starts[i + 1] = starts[i] + (sizes[i] + align - 1) / align * align;
+            }
+            return starts;
+        }
+
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    Name,
+
+        // Profile::DirtyBitIndex, the position of a PROFILE_TYPE in PROFILE_TYPES.
+        enum class TypeIndex : uint32_t
+        {
+            PROFILE_TYPES
+
+            Count
+        };
+
+#undef PROFILE_TYPE
+
+        // A PROFILE_TYPE looked up by its key enum. Profile is written as templates over it,
+        // so a type costs this, its storage and its Listener::onProfile(); the code of get(),
+        // set() and the rest is generated only for the types a translation unit uses.
+        template <typename Enum>
+        struct ProfileType;
+
+#define PROFILE_TYPE(Enum, Name, Type, Size)                \
+    template <>                                             \
+    struct ProfileType<Enum>                                \
+    {                                                       \
+        using Value = Type;                                 \
+        static constexpr TypeIndex Index = TypeIndex::Name; \
+        static constexpr size_t KeysCount = Size;           \
+    };
+
+        PROFILE_TYPES
+
+#undef PROFILE_TYPE
+
+        // Key enum of a PROFILE_TYPE.
+        template <typename Enum>
+        concept ProfileKey = requires { ProfileType<Enum>::Index; };
+
+        template <typename Enum>
+        using ValueOf = typename ProfileType<Enum>::Value;
+
+        template <typename Enum>
+        using ValueRefOf = ValueRef<ValueOf<Enum>, ProfileType<Enum>::KeysCount>;
+
+    } // namespace detail
+
     class Profile
     {
+    public:
+        using DirtyBitIndex = detail::TypeIndex;
+
+        static constexpr size_t TypesCount = static_cast<size_t>(DirtyBitIndex::Count);
+
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    +(Size)
+
+        static constexpr size_t KeysCount = 0 PROFILE_TYPES;
+
+#undef PROFILE_TYPE
+
+        // One bit per PROFILE_TYPE, a single word for up to 64 types.
+        using DirtyTypes = detail::Bitset<TypesCount>;
+        using TypesMask = detail::Bitset<TypesCount>;
+
+        class Listener;
+
+    private:
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    (Size),
+
+        static constexpr std::array<size_t, TypesCount> TypeSizes{ PROFILE_TYPES };
+
+#undef PROFILE_TYPE
+
+        // Per-key state of all types lives in shared tables, a type starts at FirstKeys[type]
+        // of the per-key counters and at bit FirstBits[type] of a KeyBits, which is word
+        // aligned, so the keys of a type are a range of whole words.
+        static constexpr auto FirstKeys = detail::rangeStarts(TypeSizes);
+        static constexpr auto FirstBits = detail::rangeStarts(TypeSizes, 64);
+
+        using KeyBits = detail::Bitset<FirstBits[TypesCount]>;
+
+        // Listeners live in slots, subscription lists refer to them by (slot, generation).
+        struct Handle
+        {
+            uint32_t slot;
+            uint32_t generation;
+        };
+
+        struct Slot
+        {
+            Listener* listener;
+            uint32_t generation;
+        };
+
+    public:
+
+        // Type erased key, used where keys of different types are reported together.
+        struct Key
+        {
+            DirtyBitIndex type;
+            uint32_t index;
+
+            template <typename Enum>
+            bool is() const
+            {
+                return type == typeOf(Enum{});
+            }
+
+            template <typename Enum>
+            Enum as() const
+            {
+                ASSERT(is<Enum>());
+                return static_cast<Enum>(index);
+            }
+
+            bool operator==(const Key&) const = default;
+        };
+
+        template <detail::ProfileKey Enum>
+        static constexpr Key makeKey(Enum e)
+        {
+            return Key{ typeOf(e), static_cast<uint32_t>(e) };
+        }
+
+        // Key names, for enums declared with PROFILE_ENUM (see EasyProfileKeys.h).
+        template <detail::NamedEnum Enum>
+        static constexpr std::string_view getName(Enum e)
+        {
+            return easyprofile::getName(e);
+        }
+
+        template <detail::NamedEnum Enum>
+        static constexpr std::optional<Enum> findKey(std::string_view name)
+        {
+            return easyprofile::findKey<Enum>(name);
+        }
+
     public:
         class Listener
         {
         public:
+            enum class Subscription
+            {
+                AllKeys,      // Notified about every key.
+                SelectedKeys, // Notified only about keys passed to Profile::subscribe().
+            };
+
             virtual ~Listener()
             {
                 m_profile->unsubscribe(this);
@@ -76,6 +396,13 @@ namespace easyprofile
 
 #undef PROFILE_TYPE
 
+            // Called once per batch with the keys changed by it (see Profile::Batch).
+            // The default implementation calls onProfile() for each key with its current value.
+            virtual void onProfileBatch(std::span<const Key> keys)
+            {
+                m_profile->notifyKeys(m_handle, keys);
+            }
+
         public:
             Profile* getProfile() const
             {
@@ -88,19 +415,81 @@ namespace easyprofile
             }
 
         protected:
-            Listener(Profile* profile, const char* name)
+            Listener(Profile* profile, const char* name, Subscription subscription = Subscription::AllKeys)
+                : Listener(profile, name, allTypes(), subscription)
+            {
+            }
+
+            // Broadcast only the types set in the mask, other onProfile() overloads are never called.
+            Listener(Profile* profile, const char* name, const TypesMask& types, Subscription subscription = Subscription::AllKeys)
                 : m_profile(profile)
                 , m_name(name)
+                , m_subscription(subscription)
+                , m_types(types)
             {
                 m_profile->subscribe(this);
             }
 
         private:
+            friend class Profile;
+
             Listener(const Listener&) = delete;
             Listener& operator=(const Listener&) = delete;
 
+            static TypesMask allTypes()
+            {
+                TypesMask types;
+                for (size_t i = 0; i < TypesCount; i++)
+                {
+                    types.set(i);
+                }
+                return types;
+            }
+
+        private:
             Profile* m_profile;
             const char* m_name;
+            Subscription m_subscription;
+            TypesMask m_types;
+            Handle m_handle{ NoSlot, 0u };
+            size_t m_entries = 0;
+            size_t m_batchIndex = NoBatchIndex;
+        };
+
+        // CRTP listener, registered only for the types whose onProfile() Derived overrides.
+        // Overriding onProfileBatch() registers it for all types.
+        // The overrides must be accessible (public) to be detected.
+        template <typename Derived>
+        class ListenerT : public Listener
+        {
+        protected:
+            ListenerT(Profile* profile, const char* name, Subscription subscription = Subscription::AllKeys)
+                : Listener(profile, name, overriddenTypes(), subscription)
+            {
+            }
+
+        private:
+            static TypesMask overriddenTypes()
+            {
+                if constexpr (detail::overridesOnProfileBatch<Derived, Listener, std::span<const Key>>())
+                {
+                    return allTypes();
+                }
+
+                TypesMask types;
+
+#define PROFILE_TYPE(Enum, Name, Type, Size)                                          \
+    if constexpr (detail::overridesOnProfile<Derived, Listener, Enum, const Type&>()) \
+    {                                                                                 \
+        types.set(index(DirtyBitIndex::Name));                                        \
+    }
+
+                PROFILE_TYPES
+
+#undef PROFILE_TYPE
+
+                return types;
+            }
         };
 
     public:
@@ -109,195 +498,1510 @@ namespace easyprofile
 
         virtual ~Profile() = default;
 
-        void init(
+        // Default values of every PROFILE_TYPE, referenced rather than copied. Declared
+        // constexpr over arrays with static storage, it is a profile readable at compile
+        // time, and profiles created from it copy a type's defaults only on its first write.
+        class Defaults final
+        {
+        public:
+            constexpr Defaults(
 #define PROFILE_TYPE(Enum, Name, Type, Size) \
-    const std::array<Type, Size>&def##Name,
+    detail::DefaultsRef<Type, Size> def##Name,
 
-            PROFILE_TYPES
+                PROFILE_TYPES
 
 #undef PROFILE_TYPE
 
-            int dummy
-            = 0)
-        {
-            (void)dummy;
+                int dummy
+                = 0)
+            {
+                (void)dummy;
 
 #define PROFILE_TYPE(Enum, Name, Type, Size) \
-    m_container##Name = def##Name;
+    m_defaults##Name = &def##Name.values();
 
-            PROFILE_TYPES
+                PROFILE_TYPES
 
 #undef PROFILE_TYPE
+            }
 
-            m_dirtyFlags = 0u;
-        }
-
-    public:
-#define PROFILE_TYPE(Enum, Name, Type, Size)              \
-    const Type& get(Enum e) const                         \
-    {                                                     \
-        return m_container##Name[static_cast<size_t>(e)]; \
+#define PROFILE_TYPE(Enum, Name, Type, Size)                      \
+    constexpr const Type& get(Enum e) const                       \
+    {                                                             \
+        return (*m_defaults##Name)[static_cast<size_t>(e)];       \
+    }                                                             \
+                                                                  \
+    constexpr const std::array<Type, Size>& getValues(Enum) const \
+    {                                                             \
+        return *m_defaults##Name;                                 \
     }
 
-        PROFILE_TYPES
+            PROFILE_TYPES
 
 #undef PROFILE_TYPE
 
-        // ---------------------------------------------------------------------
-
-    public:
-#define PROFILE_TYPE(Enum, Name, Type, Size)                         \
-    void set(Enum e, const Type& value, bool notifyListeners = true) \
-    {                                                                \
-        auto& v = m_container##Name[static_cast<size_t>(e)];         \
-        if (v != value)                                              \
-        {                                                            \
-            m_dirtyFlags |= bit(DirtyBitIndex::Name);                \
-            v = value;                                               \
-            if (notifyListeners)                                     \
-            {                                                        \
-                notify(e, value);                                    \
-            }                                                        \
-        }                                                            \
-    }
+        private:
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    const std::array<Type, Size>* m_defaults##Name = nullptr;
 
-        PROFILE_TYPES
+            PROFILE_TYPES
 
 #undef PROFILE_TYPE
+        };
 
-        // ---------------------------------------------------------------------
+        // Resets every value to the shared defaults without copying them.
+        void init(const Defaults& defaults)
+        {
+            forEachType([&](auto tag) {
+                container(tag).share(defaults.getValues(tag));
+            });
 
-    public:
+            publishAll();
+            resetDirty();
+        }
+
+        // Resets every value to a copy of the arrays. They are kept for reset() and must
+        // outlive the profile, temporaries do not compile.
+        void init(
 #define PROFILE_TYPE(Enum, Name, Type, Size) \
-    Name,
+    detail::DefaultsRef<Type, Size> def##Name,
 
-        enum class DirtyBitIndex : uint32_t
-        {
             PROFILE_TYPES
-        };
 
 #undef PROFILE_TYPE
 
-        bool isDirty(DirtyBitIndex idx) const
+            int dummy
+            = 0)
         {
-            return (m_dirtyFlags & bit(idx)) != 0u;
+            (void)dummy;
+
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    m_container##Name.init(def##Name.values());
+
+            PROFILE_TYPES
+
+#undef PROFILE_TYPE
+
+            publishAll();
+            resetDirty();
         }
 
-        bool isDirty() const
+    public:
+        template <detail::ProfileKey Enum>
+        detail::ValueRefOf<Enum> get(Enum e) const
         {
-            return m_dirtyFlags != 0u;
+            tally(e, &KeyStats::gets);
+            return container(e)[static_cast<size_t>(e)];
         }
 
-        uint32_t getDirty() const
+        // String value as a view, for std::string types with any storage.
+        template <typename Enum>
+        auto getView(Enum e) const -> decltype(std::string_view(this->get(e)))
         {
-            return m_dirtyFlags;
+            return std::string_view(get(e));
         }
 
-        void resetDirty(DirtyBitIndex idx)
-        {
-            m_dirtyFlags &= ~bit(idx);
+#if defined(EASY_PROFILE_CONCURRENT_READS)
+    private:
+#    define PROFILE_TYPE(Enum, Name, Type, Size)             \
+        detail::Mirror<Type, Size>& mirror(Enum)             \
+        {                                                    \
+            return m_mirror##Name;                           \
+        }                                                    \
+                                                             \
+        const detail::Mirror<Type, Size>& mirror(Enum) const \
+        {                                                    \
+            return m_mirror##Name;                           \
         }
 
-        void resetDirty()
+        PROFILE_TYPES
+
+#    undef PROFILE_TYPE
+
+    public:
+        // Copy of a value, safe to call from any thread while the owner thread changes it.
+        // Trivially copyable types are read through a seqlock, others through pin().
+        template <typename Enum>
+        auto fetch(Enum e) const -> decltype(this->mirror(e).load(size_t{}))
         {
-            m_dirtyFlags = 0u;
+            return mirror(e).load(static_cast<size_t>(e));
         }
 
-    private:
-        constexpr uint32_t bit(DirtyBitIndex idx) const
+        // Current version of a non-trivially copyable value without copying it, wait-free.
+        // set() publishes a new version, the pinned one is freed after the handle is gone.
+        template <typename Enum>
+        auto pin(Enum e) const -> decltype(this->mirror(e).pin(size_t{}))
         {
-            return 1u << static_cast<uint32_t>(idx);
+            return mirror(e).pin(static_cast<size_t>(e));
         }
+#endif
 
-    private:
-        void subscribe(Listener* listener)
+        // ---------------------------------------------------------------------
+
+    public:
+        // set() assigns only if the value differs, the rvalue overload moves it in.
+        // emplace() constructs the new value from args and moves it in.
+        // modify() mutates the value in place; func(Type&) may return bool "changed",
+        // otherwise a copy of the old value is compared with the result.
+        // The value is a parameter of the key's type, not deduced, so it converts as it
+        // would for a plain overload.
+        template <detail::ProfileKey Enum>
+        void set(Enum e, const detail::ValueOf<Enum>& value, bool notifyListeners = true)
         {
-#if defined(DEBUG)
-            auto it = std::find(m_listeners.begin(), m_listeners.end(), listener);
-            ASSERT(it == m_listeners.end());
-#endif
-            m_listeners.push_back(listener);
-            logListenerAdded(listener, m_listeners.size());
+            auto idx = static_cast<size_t>(e);
+            tally(e, &KeyStats::sets);
+            capture(e, notifyListeners);
+            if (container(e).set(idx, value))
+            {
+                changed(e, container(e)[idx], notifyListeners);
+            }
         }
 
-        void unsubscribe(Listener* listener)
+        template <detail::ProfileKey Enum>
+        void set(Enum e, detail::ValueOf<Enum>&& value, bool notifyListeners = true)
         {
-            auto it = std::find(m_listeners.begin(), m_listeners.end(), listener);
-            if (it != m_listeners.end())
+            auto idx = static_cast<size_t>(e);
+            tally(e, &KeyStats::sets);
+            capture(e, notifyListeners);
+            if (container(e).set(idx, std::move(value)))
             {
-                m_listeners.erase(it);
-                logListenerRemoved(listener, m_listeners.size());
+                changed(e, container(e)[idx], notifyListeners);
             }
         }
 
-    protected:
-        virtual void logListenerAdded(const Listener* listener, size_t totalListeners) const
+        template <detail::ProfileKey Enum, typename... Args>
+        void emplace(Enum e, Args&&... args)
         {
-            // Implement logging if needed
-            // ::printf("Profile Listener '%s' added, total: %zu.\n", listener->getName(), totalListeners);
-            (void)listener;
-            (void)totalListeners;
+            set(e, detail::ValueOf<Enum>(std::forward<Args>(args)...));
         }
 
-        virtual void logListenerRemoved(const Listener* listener, size_t totalListeners) const
+        template <detail::ProfileKey Enum, typename Func>
+        void modify(Enum e, Func&& func, bool notifyListeners = true)
         {
-            // Implement logging if needed
-            // ::printf("Profile Listener '%s' removed, remain: %zu.\n", listener->getName(), totalListeners);
-            (void)listener;
-            (void)totalListeners;
+            auto idx = static_cast<size_t>(e);
+            tally(e, &KeyStats::sets);
+            capture(e, notifyListeners);
+            if (container(e).modify(idx, std::forward<Func>(func)))
+            {
+                changed(e, container(e)[idx], notifyListeners);
+            }
         }
 
+        // ---------------------------------------------------------------------
+
     private:
-#define PROFILE_TYPE(Enum, Name, Type, Size)     \
-    void notify(Enum e, const Type& value) const \
-    {                                            \
-        for (auto* l : m_listeners)              \
-        {                                        \
-            l->onProfile(e, value);              \
-        }                                        \
+        // Storage of every type, the only members declared per type.
+#define PROFILE_TYPE(Enum, Name, Type, Size)                 \
+    detail::Storage<Type, Size>& container(Enum)             \
+    {                                                        \
+        return m_container##Name;                            \
+    }                                                        \
+                                                             \
+    const detail::Storage<Type, Size>& container(Enum) const \
+    {                                                        \
+        return m_container##Name;                            \
     }
 
         PROFILE_TYPES
 
 #undef PROFILE_TYPE
 
-    protected:
-        explicit Profile() = default;
-
-        Profile(
+        // Calls func(Enum{}) for every type, in the order of PROFILE_TYPES.
+        template <typename Func>
+        static void forEachType(Func&& func)
+        {
 #define PROFILE_TYPE(Enum, Name, Type, Size) \
-    const std::array<Type, Size>&def##Name,
+    func(Enum{});
 
             PROFILE_TYPES
 
 #undef PROFILE_TYPE
+        }
 
-            int dummy
-            = 0)
+    public:
+        // Bulk set of the keys starting at first: unchanged values are skipped a chunk at
+        // a time, changed keys are marked dirty and reported to listeners in one
+        // onProfileBatch(). Returns the number of changed keys.
+        template <detail::ProfileKey Enum>
+        size_t setRange(Enum first, std::span<const detail::ValueOf<Enum>> values, bool notifyListeners = true)
+        {
+            ASSERT(static_cast<size_t>(first) + values.size() <= detail::ProfileType<Enum>::KeysCount);
+            if (m_batchDepth != 0 && notifyListeners)
+            {
+                captureRange(first, values);
+            }
+
+            Batch batch(*this);
+            tallyRange(makeKey(first), values.size(), &KeyStats::sets);
+            size_t count = 0;
+            container(first).setRange(static_cast<size_t>(first), values, [&](size_t idx) {
+                auto e = static_cast<Enum>(idx);
+                auto key = makeKey(e);
+                publish(e);
+                tally(key, &KeyStats::changes);
+                m_dirtyKeys.set(bitOf(key));
+                if (notifyListeners)
+                {
+                    enqueue(key, false);
+                }
+                count++;
+            });
+            if (count != 0)
+            {
+                m_dirtyTypes.set(index(typeOf(first)));
+            }
+            return count;
+        }
+
+        // All values of a type, valid until the next change. Not available with
+        // EASY_PROFILE_OVERLAY, which doesn't store values contiguously.
+        template <typename Enum>
+        auto getSpan() const -> decltype(this->container(Enum{}).span())
+        {
+            return container(Enum{}).span();
+        }
+
+        // ---------------------------------------------------------------------
+
+    public:
+        // Restores defaults through set(), so changed keys become dirty and listeners are
+        // notified. resetType() and resetAll() notify within one Batch and visit only keys
+        // that differ; afterwards the profile reads the shared defaults again.
+        template <detail::ProfileKey Enum>
+        void reset(Enum e, bool notifyListeners = true)
+        {
+            set(e, container(e).defaults()[static_cast<size_t>(e)], notifyListeners);
+        }
+
+        template <typename Enum>
+        void resetType(bool notifyListeners = true)
+        {
+            Batch batch(*this);
+
+            auto& values = container(Enum{});
+            values.forEachNonDefault([&](size_t idx, const auto&) {
+                reset(static_cast<Enum>(idx), notifyListeners);
+            });
+            values.resetAll();
+        }
+
+        void resetAll(bool notifyListeners = true)
+        {
+            Batch batch(*this);
+
+            forEachType([&](auto tag) {
+                resetType<decltype(tag)>(notifyListeners);
+            });
+        }
+
+        // Calls func(key, value) for every key of Enum that differs from its default.
+        // Trivially copyable values are compared a chunk of keys at a time.
+        template <typename Enum, typename Func>
+        void forEachNonDefault(Func&& func) const
+        {
+            container(Enum{}).forEachNonDefault([&](size_t idx, const auto& value) {
+                func(static_cast<Enum>(idx), value);
+            });
+        }
+
+        // Same for every type, func must accept any key type.
+        template <typename Func>
+        void forEachNonDefault(Func&& func) const
+        {
+            forEachType([&](auto tag) {
+                forEachNonDefault<decltype(tag)>(func);
+            });
+        }
+
+#if defined(EASY_PROFILE_STATS)
+        // ---------------------------------------------------------------------
+
+    public:
+        // Counters collected since construction or resetStats(), owner thread only.
+        struct Stats
+        {
+            struct HotKey
+            {
+                Key key;
+                KeyStats stats;
+            };
+
+            KeyStats total;
+            std::vector<HotKey> hotKeys;
+
+            // Share of set() calls that didn't change the value.
+            double wastedSetRatio() const
+            {
+                return total.sets != 0 ? static_cast<double>(total.wastedSets()) / static_cast<double>(total.sets) : 0.0;
+            }
+        };
+
+        // Totals of all keys and the top most written keys, ties broken by reads.
+        Stats stats(size_t top = 10) const
+        {
+            Stats result;
+
+            for (size_t i = 0; i < TypesCount; i++)
+            {
+                m_stats.forEach(FirstKeys[i], FirstKeys[i + 1], [&](size_t idx, const KeyStats& stats) {
+                    result.total += stats;
+                    result.hotKeys.push_back({ Key{ static_cast<DirtyBitIndex>(i), static_cast<uint32_t>(idx - FirstKeys[i]) }, stats });
+                });
+            }
+
+            auto hotter = [](const Stats::HotKey& a, const Stats::HotKey& b) {
+                return a.stats.sets != b.stats.sets ? a.stats.sets > b.stats.sets : a.stats.gets > b.stats.gets;
+            };
+            top = std::min(top, result.hotKeys.size());
+            std::partial_sort(result.hotKeys.begin(), result.hotKeys.begin() + static_cast<std::ptrdiff_t>(top),
+                              result.hotKeys.end(), hotter);
+            result.hotKeys.resize(top);
+            return result;
+        }
+
+        void resetStats()
+        {
+            m_stats.clear();
+        }
+#endif
+
+#if defined(EASY_PROFILE_TRACE)
+        // ---------------------------------------------------------------------
+
+    public:
+        // Every onProfile() and onProfileBatch() call is timed and recorded in the tracer,
+        // nullptr detaches it. The tracer must outlive the profile or be detached first.
+        void setTracer(Tracer* tracer)
+        {
+            m_tracer = tracer;
+        }
+
+        Tracer* getTracer() const
+        {
+            return m_tracer;
+        }
+#endif
+
+        // ---------------------------------------------------------------------
+
+    public:
+        // Groups set() calls: values are applied immediately, but listeners are notified once,
+        // via onProfileBatch(), when the outermost batch ends. A key changed several times is
+        // reported once and listeners see its last value.
+        class Batch final
+        {
+        public:
+            explicit Batch(Profile& profile)
+                : m_profile(profile)
+            {
+                m_profile.beginUpdate();
+            }
+
+            ~Batch()
+            {
+                m_profile.commit();
+            }
+
+        private:
+            Batch(const Batch&) = delete;
+            Batch& operator=(const Batch&) = delete;
+
+            Profile& m_profile;
+        };
+
+        void beginUpdate()
+        {
+            m_batchDepth++;
+        }
+
+        void commit()
+        {
+            ASSERT(m_batchDepth != 0);
+            if (--m_batchDepth == 0)
+            {
+                flush();
+            }
+        }
+
+        // In deferred mode set() only records changed keys, listeners are notified by pump().
+        // Deferred mode behaves like a batch that stays open, so the pending queue
+        // never holds more than KeysCount entries and is allocated once here.
+        void setDeferred(bool deferred)
+        {
+            if (m_deferred != deferred)
+            {
+                m_deferred = deferred;
+                if (deferred)
+                {
+                    m_pending.reserve(KeysCount);
+                    if (m_flushScratch.empty())
+                    {
+                        m_flushScratch.emplace_back();
+                    }
+                    m_flushScratch.front().pending.reserve(KeysCount);
+                    beginUpdate();
+                }
+                else
+                {
+                    commit();
+                }
+            }
+        }
+
+        bool isDeferred() const
+        {
+            return m_deferred;
+        }
+
+        // Dispatches notifications recorded in deferred mode, unless a Batch is still open.
+        void pump()
+        {
+            if (m_deferred && m_batchDepth == 1)
+            {
+                flush();
+            }
+        }
+
+        // ---------------------------------------------------------------------
+
+    public:
+        bool isDirty(DirtyBitIndex idx) const
+        {
+            return m_dirtyTypes.test(index(idx));
+        }
+
+        template <detail::ProfileKey Enum>
+        bool isDirty(Enum e) const
+        {
+            return m_dirtyKeys.test(bitOf(makeKey(e)));
+        }
+
+        bool isDirty() const
+        {
+            return m_dirtyTypes.any();
+        }
+
+        const DirtyTypes& getDirty() const
+        {
+            return m_dirtyTypes;
+        }
+
+        void resetDirty(DirtyBitIndex idx)
+        {
+            if (idx != DirtyBitIndex::Count)
+            {
+                m_dirtyTypes.reset(index(idx));
+                m_dirtyKeys.clear(firstWord(idx), lastWord(idx));
+            }
+        }
+
+        template <detail::ProfileKey Enum>
+        void resetDirty(Enum e)
+        {
+            auto type = typeOf(e);
+            m_dirtyKeys.reset(bitOf(makeKey(e)));
+            if (!m_dirtyKeys.any(firstWord(type), lastWord(type)))
+            {
+                m_dirtyTypes.reset(index(type));
+            }
+        }
+
+        void resetDirty()
+        {
+            m_dirtyTypes.clear();
+            m_dirtyKeys.clear();
+        }
+
+        // Calls func(Enum) for every dirty key of the given type, in ascending order.
+        template <typename Enum, typename Func>
+        void forEachDirty(Func&& func) const
+        {
+            auto type = typeOf(Enum{});
+            m_dirtyKeys.forEach(firstWord(type), lastWord(type), [&func](size_t idx) {
+                func(static_cast<Enum>(idx));
+            });
+        }
+
+        // Appends dirty keys of the given type to the output vector.
+        template <typename Enum>
+        void collectDirty(std::vector<Enum>& out) const
+        {
+            auto type = typeOf(Enum{});
+            out.reserve(out.size() + m_dirtyKeys.count(firstWord(type), lastWord(type)));
+            forEachDirty<Enum>([&out](Enum e) {
+                out.push_back(e);
+            });
+        }
+
+        // Dirty state of all keys, taken out while the keys are being persisted elsewhere.
+        class DirtySet final
+        {
+        public:
+            bool any() const
+            {
+                return m_types.any();
+            }
+
+        private:
+            friend class Profile;
+
+            DirtyTypes m_types;
+            KeyBits m_keys;
+        };
+
+        // Returns the dirty state and marks every key clean.
+        DirtySet takeDirty()
+        {
+            DirtySet result;
+            result.m_types = m_dirtyTypes;
+            result.m_keys = m_dirtyKeys;
+            resetDirty();
+            return result;
+        }
+
+        // Marks the keys of a taken set dirty again, e.g. when writing them failed.
+        void restoreDirty(const DirtySet& dirty)
+        {
+            m_dirtyTypes |= dirty.m_types;
+            m_dirtyKeys |= dirty.m_keys;
+        }
+
+    private:
+        static constexpr size_t index(DirtyBitIndex idx)
+        {
+            return static_cast<size_t>(idx);
+        }
+
+        // Position of a key in a KeyBits, and the words holding the keys of a type.
+        static constexpr size_t bitOf(const Key& key)
+        {
+            return FirstBits[index(key.type)] + key.index;
+        }
+
+        static constexpr size_t firstWord(DirtyBitIndex type)
+        {
+            return FirstBits[index(type)] / KeyBits::WordBits;
+        }
+
+        static constexpr size_t lastWord(DirtyBitIndex type)
+        {
+            return FirstBits[index(type) + 1] / KeyBits::WordBits;
+        }
+
+        // ---------------------------------------------------------------------
+
+    public:
+        // Writes all values as a versioned little-endian snapshot (see EasyProfileSnapshot.h).
+        void save(Writer& writer) const
+        {
+            snapshot::writeFileHeader(writer, static_cast<uint32_t>(TypesCount));
+
+            forEachType([&](auto tag) {
+                const auto& values = container(tag);
+                snapshot::writeSection(writer, typeHash(tag), values, values.size());
+            });
+        }
+
+        // Restores values from a snapshot with one bulk copy per trivially copyable type.
+        // Types missing from the snapshot keep their values, extra keys and types are ignored.
+        // Loaded keys become clean and listeners are not notified. Returns false, leaving
+        // the profile untouched, if the snapshot is malformed or a type changed its layout.
+        bool load(std::span<const std::byte> bytes)
+        {
+            std::array<snapshot::Section, TypesCount> sections;
+            auto indexOf = [](uint64_t hash) {
+                return index(typeOfHash(hash));
+            };
+
+            if (!snapshot::parse(bytes, sections, indexOf))
+            {
+                return false;
+            }
+
+            bool compatible = true;
+            forEachType([&](auto tag) {
+                const auto& section = sections[index(typeOf(tag))];
+                if (section.present && !snapshot::compatible<detail::ValueOf<decltype(tag)>>(section))
+                {
+                    compatible = false;
+                }
+            });
+
+            if (!compatible)
+            {
+                return false;
+            }
+
+            forEachType([&](auto tag) {
+                if (const auto& section = sections[index(typeOf(tag))]; section.present)
+                {
+                    auto& values = container(tag);
+                    auto count = std::min<size_t>(section.header.count, values.size());
+                    snapshot::readSection(section, values, count);
+                    publish(tag, count);
+                    resetDirty(typeOf(tag), count);
+                }
+            });
+
+            return true;
+        }
+
+        // Writes every dirty key with its value, the building block of incremental
+        // persistence (see EasyProfileJournal.h).
+        void saveDirty(Writer& writer) const
+        {
+            forEachType([&](auto tag) {
+                using Enum = decltype(tag);
+                static_assert(detail::ProfileType<Enum>::KeysCount <= snapshot::MaxEntryKeys);
+                forEachDirty<Enum>([&](Enum e) {
+                    auto idx = static_cast<size_t>(e);
+                    snapshot::writeEntry<detail::ValueOf<Enum>>(writer, typeHash(e), static_cast<uint32_t>(idx), container(e)[idx]);
+                });
+            });
+        }
+
+        // Writes every key that differs from its default in the saveDirty() format, so a
+        // profile is restored by init() with the same defaults and loadDirty().
+        void saveNonDefault(Writer& writer) const
+        {
+            forEachType([&](auto tag) {
+                using Enum = decltype(tag);
+                static_assert(detail::ProfileType<Enum>::KeysCount <= snapshot::MaxEntryKeys);
+                forEachNonDefault<Enum>([&](Enum e, const auto& value) {
+                    snapshot::writeEntry<detail::ValueOf<Enum>>(writer, typeHash(e), static_cast<uint32_t>(e), value);
+                });
+            });
+        }
+
+        // Applies keys written by saveDirty() in order, with the same rules as load().
+        bool loadDirty(std::span<const std::byte> bytes)
+        {
+            auto valid = snapshot::parseEntries(bytes, [this](const snapshot::Entry& entry) {
+                bool result = true;
+                visitType(typeOfHash(entry.typeHash), [&](auto tag) {
+                    using Type = typename std::remove_cvref_t<decltype(container(tag))>::value_type;
+                    result = snapshot::compatible<Type>(entry);
+                });
+                return result;
+            });
+
+            if (!valid)
+            {
+                return false;
+            }
+
+            snapshot::parseEntries(bytes, [this](const snapshot::Entry& entry) {
+                visitType(typeOfHash(entry.typeHash), [&](auto tag) {
+                    auto& values = container(tag);
+                    if (entry.index < values.size())
+                    {
+                        using Enum = decltype(tag);
+                        typename std::remove_cvref_t<decltype(values)>::value_type value{};
+                        snapshot::readEntry(entry, value);
+                        values.set(entry.index, std::move(value));
+                        publish(static_cast<Enum>(entry.index));
+                        resetDirty(static_cast<Enum>(entry.index));
+                    }
+                });
+                return true;
+            });
+
+            return true;
+        }
+
+    private:
+        // Copies a key, or the first count keys, to the concurrent mirror if enabled.
+#if defined(EASY_PROFILE_CONCURRENT_READS)
+        template <typename Enum>
+        void publish(Enum e)
+        {
+            auto idx = static_cast<size_t>(e);
+            mirror(e).store(idx, container(e)[idx]);
+        }
+
+        template <typename Enum>
+        void publish(Enum e, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                mirror(e).store(i, container(e)[i]);
+            }
+        }
+#else
+        template <typename Enum>
+        void publish(Enum)
+        {
+        }
+
+        template <typename Enum>
+        void publish(Enum, size_t)
+        {
+        }
+#endif
+
+        // Adds one to a KeyStats counter of a key, or of size keys from first on, if enabled.
+#if defined(EASY_PROFILE_STATS)
+        void tally(const Key& key, uint64_t KeyStats::*counter) const
+        {
+            m_stats[FirstKeys[index(key.type)] + key.index].*counter += 1;
+        }
+
+        void tallyRange(const Key& first, size_t size, uint64_t KeyStats::*counter)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                m_stats[FirstKeys[index(first.type)] + first.index + i].*counter += 1;
+            }
+        }
+#else
+        void tally(const Key&, uint64_t KeyStats::*) const
+        {
+        }
+
+        void tallyRange(const Key&, size_t, uint64_t KeyStats::*)
+        {
+        }
+#endif
+
+        template <detail::ProfileKey Enum>
+        void tally(Enum e, uint64_t KeyStats::*counter) const
+        {
+            tally(makeKey(e), counter);
+        }
+
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    #Name,
+
+        static constexpr std::array<const char*, TypesCount> TypeNames{ PROFILE_TYPES };
+
+#undef PROFILE_TYPE
+
+        // Runs call(), a call of the listener, timed if a Tracer is attached. key is the key
+        // index for onProfile(), type nullptr and key the number of keys for onProfileBatch().
+#if defined(EASY_PROFILE_TRACE)
+        template <typename Call>
+        void traced(const Listener* listener, const char* type, size_t key, Call&& call)
+        {
+            if (m_tracer == nullptr)
+            {
+                call();
+                return;
+            }
+
+            // The listener may remove itself during the call.
+            auto* name = listener->getName();
+            auto start = detail::traceTicks();
+            call();
+            m_tracer->record(name, type, static_cast<uint32_t>(key), start, detail::traceTicks() - start);
+        }
+#else
+        template <typename Call>
+        void traced(const Listener*, const char*, size_t, Call&& call)
+        {
+            call();
+        }
+#endif
+
+        void publishAll()
+        {
+            forEachType([this](auto tag) {
+                publish(tag, container(tag).size());
+            });
+        }
+
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    detail::hashName(#Name),
+
+        static constexpr std::array<uint64_t, TypesCount> TypeHashes{ PROFILE_TYPES };
+
+#undef PROFILE_TYPE
+
+        template <typename Enum>
+        static constexpr uint64_t typeHash(Enum e)
+        {
+            return TypeHashes[index(typeOf(e))];
+        }
+
+        // Type stored under a snapshot type hash, Count if there is none.
+        static constexpr DirtyBitIndex typeOfHash(uint64_t hash)
+        {
+            for (size_t i = 0; i < TypesCount; i++)
+            {
+                if (TypeHashes[i] == hash)
+                {
+                    return static_cast<DirtyBitIndex>(i);
+                }
+            }
+            return DirtyBitIndex::Count;
+        }
+
+        // Marks the first count keys of a type clean.
+        void resetDirty(DirtyBitIndex type, size_t count)
+        {
+            if (count == TypeSizes[index(type)])
+            {
+                m_dirtyKeys.clear(firstWord(type), lastWord(type));
+            }
+            else
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    m_dirtyKeys.reset(FirstBits[index(type)] + i);
+                }
+            }
+
+            if (!m_dirtyKeys.any(firstWord(type), lastWord(type)))
+            {
+                m_dirtyTypes.reset(index(type));
+            }
+        }
+
+        void markDirty(const Key& key)
+        {
+            m_dirtyTypes.set(index(key.type));
+            m_dirtyKeys.set(bitOf(key));
+        }
+
+    public:
+        // Per-key subscriptions for listeners created with Subscription::SelectedKeys.
+        // Range subscriptions cover [first, last).
+        template <detail::ProfileKey Enum>
+        void subscribe(Listener* listener, Enum e)
+        {
+            subscribeKey(listener, makeKey(e));
+        }
+
+        template <detail::ProfileKey Enum>
+        void subscribe(Listener* listener, Enum first, Enum last)
+        {
+            for (auto i = static_cast<size_t>(first); i < static_cast<size_t>(last); i++)
+            {
+                subscribeKey(listener, makeKey(static_cast<Enum>(i)));
+            }
+        }
+
+        template <detail::ProfileKey Enum>
+        void unsubscribe(Listener* listener, Enum e)
+        {
+            unsubscribeKey(listener, makeKey(e));
+        }
+
+    private:
+        using KeyListeners = std::vector<std::vector<Handle>>;
+
+        // Listeners of a type: the broadcast ones, and per key those subscribed to it.
+        struct Subscribers
+        {
+            std::vector<Handle> broadcast;
+            KeyListeners keys;
+        };
+
+        static constexpr uint32_t NoSlot = std::numeric_limits<uint32_t>::max();
+        static constexpr size_t CompactThreshold = 64;
+
+        Listener* resolve(const Handle& handle) const
+        {
+            if (handle.slot < m_slots.size())
+            {
+                const auto& slot = m_slots[handle.slot];
+                if (slot.generation == handle.generation)
+                {
+                    return slot.listener;
+                }
+            }
+            return nullptr;
+        }
+
+        void subscribe(Listener* listener)
+        {
+            uint32_t slot;
+            if (!m_freeSlots.empty())
+            {
+                slot = m_freeSlots.back();
+                m_freeSlots.pop_back();
+            }
+            else
+            {
+                slot = static_cast<uint32_t>(m_slots.size());
+                m_slots.push_back(Slot{ nullptr, 0u });
+            }
+            m_slots[slot].listener = listener;
+            listener->m_handle = Handle{ slot, m_slots[slot].generation };
+            m_listenersCount++;
+
+            if (listener->m_subscription == Listener::Subscription::AllKeys)
+            {
+                for (size_t i = 0; i < TypesCount; i++)
+                {
+                    if (listener->m_types.test(i))
+                    {
+                        addEntry(m_subscribers[i].broadcast, listener);
+                    }
+                }
+            }
+            logListenerAdded(listener, m_listenersCount);
+        }
+
+        void unsubscribe(Listener* listener)
+        {
+            auto handle = listener->m_handle;
+            if (resolve(handle) == listener)
+            {
+                // Bumping the generation invalidates every list entry of the listener,
+                // they are skipped by dispatch and swept by compact().
+                auto& slot = m_slots[handle.slot];
+                slot.listener = nullptr;
+                slot.generation++;
+                m_freeSlots.push_back(handle.slot);
+                m_listenersCount--;
+
+                m_staleCount += listener->m_entries;
+                m_entriesCount -= listener->m_entries;
+                listener->m_entries = 0;
+
+                logListenerRemoved(listener, m_listenersCount);
+                compactIfNeeded();
+            }
+        }
+
+        void addEntry(std::vector<Handle>& list, Listener* listener)
+        {
+            list.push_back(listener->m_handle);
+            listener->m_entries++;
+            m_entriesCount++;
+        }
+
+        void subscribeKey(Listener* listener, const Key& key)
+        {
+            ASSERT(listener->m_subscription == Listener::Subscription::SelectedKeys);
+
+            // Allocate the per-key index only for types somebody subscribes to.
+            auto& keyListeners = m_subscribers[index(key.type)].keys;
+            if (keyListeners.empty())
+            {
+                keyListeners.resize(TypeSizes[index(key.type)]);
+            }
+
+            auto& list = keyListeners[key.index];
+#if defined(DEBUG)
+            auto it = std::find_if(list.begin(), list.end(), [&](const Handle& h) {
+                return resolve(h) == listener;
+            });
+            ASSERT(it == list.end());
+#endif
+            addEntry(list, listener);
+        }
+
+        void unsubscribeKey(Listener* listener, const Key& key)
+        {
+            auto& keyListeners = m_subscribers[index(key.type)].keys;
+            if (keyListeners.empty())
+            {
+                return;
+            }
+
+            for (auto& h : keyListeners[key.index])
+            {
+                if (resolve(h) == listener)
+                {
+                    // Leave a tombstone, the list may be iterated right now.
+                    h = Handle{ NoSlot, 0u };
+                    listener->m_entries--;
+                    m_entriesCount--;
+                    m_staleCount++;
+                    break;
+                }
+            }
+            compactIfNeeded();
+        }
+
+        // Sweeps stale entries once they outnumber live ones, never during dispatch.
+        void compactIfNeeded()
+        {
+            if (m_dispatchDepth == 0 && m_staleCount > CompactThreshold && m_staleCount > m_entriesCount)
+            {
+                compact();
+            }
+        }
+
+        void compact()
+        {
+            auto isStale = [this](const Handle& h) {
+                return resolve(h) == nullptr;
+            };
+
+            for (auto& subscribers : m_subscribers)
+            {
+                std::erase_if(subscribers.broadcast, isStale);
+                for (auto& list : subscribers.keys)
+                {
+                    std::erase_if(list, isStale);
+                }
+            }
+
+            m_staleCount = 0;
+        }
+
+        // Defers compaction while listeners are being called.
+        class DispatchScope final
+        {
+        public:
+            explicit DispatchScope(Profile& profile)
+                : m_profile(profile)
+            {
+                m_profile.m_dispatchDepth++;
+            }
+
+            ~DispatchScope()
+            {
+                if (--m_profile.m_dispatchDepth == 0)
+                {
+                    m_profile.compactIfNeeded();
+                }
+            }
+
+        private:
+            DispatchScope(const DispatchScope&) = delete;
+            DispatchScope& operator=(const DispatchScope&) = delete;
+
+            Profile& m_profile;
+        };
+
+    protected:
+        virtual void logListenerAdded(const Listener* listener, size_t totalListeners) const
+        {
+            // Implement logging if needed
+            // ::printf("Profile Listener '%s' added, total: %zu.\n", listener->getName(), totalListeners);
+            (void)listener;
+            (void)totalListeners;
+        }
+
+        virtual void logListenerRemoved(const Listener* listener, size_t totalListeners) const
+        {
+            // Implement logging if needed
+            // ::printf("Profile Listener '%s' removed, remain: %zu.\n", listener->getName(), totalListeners);
+            (void)listener;
+            (void)totalListeners;
+        }
+
+    private:
+        static constexpr size_t NoBatchIndex = std::numeric_limits<size_t>::max();
+
+        template <detail::ProfileKey Enum>
+        static constexpr DirtyBitIndex typeOf(Enum)
+        {
+            return detail::ProfileType<Enum>::Index;
+        }
+
+        // captured: the value of the key before this change was kept by capture().
+        void enqueue(const Key& key, bool captured)
+        {
+            auto bit = bitOf(key);
+            if (!m_pendingKeys.test(bit))
+            {
+                m_pendingKeys.set(bit);
+                m_pending.push_back(key);
+                if (captured)
+                {
+                    m_capturedKeys.set(bit);
+                    m_originalsCount[index(key.type)]++;
+                }
+            }
+        }
+
+        // Values of keys before their first change in the open batch, one list per type in
+        // the order the keys were enqueued. A key set back to its value by the time the batch
+        // commits is not reported. Lists keep their elements, so once grown a capture is an
+        // assignment.
+        using Originals = std::tuple<std::monostate
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    , std::vector<Type>
+                                     PROFILE_TYPES
+#undef PROFILE_TYPE
+                                     >;
+
+        template <typename Enum>
+        std::vector<detail::ValueOf<Enum>>& originals()
+        {
+            return std::get<static_cast<size_t>(detail::ProfileType<Enum>::Index) + 1>(m_originals);
+        }
+
+        // Keeps the current value of a key about to change inside a batch, unless it is
+        // already pending. It counts once enqueue() takes the key, otherwise the next
+        // capture of the type overwrites it.
+        template <typename Enum>
+        void capture(Enum e, bool notifyListeners)
+        {
+            if (!notifyListeners || m_batchDepth == 0 || m_pendingKeys.test(bitOf(makeKey(e))))
+            {
+                return;
+            }
+
+            auto& list = originals<Enum>();
+            auto count = m_originalsCount[index(typeOf(e))];
+            const auto& value = container(e)[static_cast<size_t>(e)];
+            if (count < list.size())
+            {
+                list[count] = value;
+            }
+            else
+            {
+                list.emplace_back(value);
+            }
+        }
+
+        // setRange() inside a batch: keys about to change are captured and enqueued up front,
+        // their old values are gone once the storage applies the range.
+        template <typename Enum>
+        void captureRange(Enum first, std::span<const detail::ValueOf<Enum>> values)
+        {
+            const auto& current = container(first);
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                auto e = static_cast<Enum>(static_cast<size_t>(first) + i);
+                if (detail::differs(current[static_cast<size_t>(e)], values[i]))
+                {
+                    capture(e, true);
+                    enqueue(makeKey(e), true);
+                }
+            }
+        }
+
+        // True if a captured key holds its value from before the batch again.
+        bool restored(const Key& key, size_t slot)
+        {
+            bool result = false;
+            visitType(key.type, [&](auto tag) {
+                using Enum = decltype(tag);
+                result = !detail::differs(container(tag)[key.index], originals<Enum>()[slot]);
+            });
+            return result;
+        }
+
+        template <typename Enum, typename Type>
+        void changed(Enum e, const Type& value, bool notifyListeners)
+        {
+            auto key = makeKey(e);
+            publish(e);
+            tally(key, &KeyStats::changes);
+            markDirty(key);
+            if (notifyListeners)
+            {
+                if (m_batchDepth != 0)
+                {
+                    enqueue(key, true);
+                }
+                else
+                {
+                    notify(e, value);
+                }
+            }
+        }
+
+        // Calls func(Enum{}) with the enum type the index stands for.
+        template <typename Func>
+        static void visitType(DirtyBitIndex type, Func&& func)
+        {
+            switch (type)
+            {
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    case DirtyBitIndex::Name:                \
+        func(Enum{});                        \
+        break;
+
+                PROFILE_TYPES
+
+#undef PROFILE_TYPE
+
+            case DirtyBitIndex::Count:
+                break;
+            }
+        }
+
+        // Calls func(Listener*) for every live listener interested in the key.
+        template <typename Func>
+        void forEachListener(const Key& key, Func&& func) const
+        {
+            auto visit = [&](const std::vector<Handle>& list) {
+                for (const auto& h : list)
+                {
+                    if (auto* l = resolve(h))
+                    {
+                        func(l);
+                    }
+                }
+            };
+
+            const auto& subscribers = m_subscribers[index(key.type)];
+            visit(subscribers.broadcast);
+            if (!subscribers.keys.empty())
+            {
+                visit(subscribers.keys[key.index]);
+            }
+        }
+
+        void notifyKey(Listener* listener, const Key& key) const
+        {
+            visitType(key.type, [&](auto tag) {
+                using Enum = decltype(tag);
+                withStableValue<Enum>(container(tag)[key.index], [&](const auto& value) {
+                    listener->onProfile(static_cast<Enum>(key.index), value);
+                });
+            });
+        }
+
+        // Calls func(const Type&) with a stored value. A string arena view is copied first,
+        // a listener setting another key may move the arena while later ones still run.
+        template <typename Enum, typename Value, typename Func>
+        static void withStableValue(const Value& value, Func&& func)
+        {
+            using Type = detail::ValueOf<Enum>;
+            if constexpr (std::is_same_v<Value, Type>)
+            {
+                func(value);
+            }
+            else
+            {
+                const Type copy(value);
+                func(copy);
+            }
+        }
+
+        // Per-key fallback of onProfileBatch(), stops if the listener removes itself.
+        void notifyKeys(Handle handle, std::span<const Key> keys) const
+        {
+            for (const auto& key : keys)
+            {
+                auto* listener = resolve(handle);
+                if (listener == nullptr)
+                {
+                    break;
+                }
+                notifyKey(listener, key);
+            }
+        }
+
+        // onProfile() of a type, so the listener loops below are shared by all types
+        // rather than generated for each of them.
+        using OnProfile = void (*)(Listener* listener, uint32_t key, const void* value);
+
+        template <typename Enum>
+        static void onProfile(Listener* listener, uint32_t key, const void* value)
+        {
+            listener->onProfile(static_cast<Enum>(key), *static_cast<const detail::ValueOf<Enum>*>(value));
+        }
+
+        // Iterates by index up to the initial size: listeners added during dispatch
+        // wait for the next change, removed ones no longer resolve and are skipped.
+        void notifyList(const std::vector<Handle>& list, const Key& key, OnProfile call, const void* value)
+        {
+            for (size_t i = 0, count = list.size(); i < count; i++)
+            {
+                if (auto* l = resolve(list[i]))
+                {
+                    tally(key, &KeyStats::notifies);
+                    traced(l, TypeNames[index(key.type)], key.index, [&] {
+                        call(l, key.index, value);
+                    });
+                }
+            }
+        }
+
+        // Buffers of flush(), one per nesting level. They live in a deque, so outer levels
+        // stay in place while a nested flush adds one.
+        struct FlushScratch
+        {
+            std::vector<Key> pending;
+            std::vector<Handle> listeners;
+            std::vector<std::vector<Key>> keys;
+        };
+
+        void flush()
+        {
+            if (m_pending.empty())
+            {
+                return;
+            }
+
+            DispatchScope scope(*this);
+
+            // A listener may commit a batch and flush again while this one dispatches, so
+            // each nesting level has its own buffers. The pending keys are copied out, so the
+            // queue and every level keep their allocations.
+            if (m_flushDepth == m_flushScratch.size())
+            {
+                m_flushScratch.emplace_back();
+            }
+            auto& scratch = m_flushScratch[m_flushDepth++];
+            auto& pending = scratch.pending;
+            auto& listeners = scratch.listeners;
+            auto& keys = scratch.keys;
+            pending.assign(m_pending.begin(), m_pending.end());
+            m_pending.clear();
+
+            // Group changed keys by listener, in order of first appearance. Keys set back to
+            // their value from before the batch are dropped.
+            std::array<uint32_t, TypesCount> captured{};
+            for (const auto& key : pending)
+            {
+                auto bit = bitOf(key);
+                m_pendingKeys.reset(bit);
+                if (m_capturedKeys.test(bit))
+                {
+                    m_capturedKeys.reset(bit);
+                    if (restored(key, captured[index(key.type)]++))
+                    {
+                        continue;
+                    }
+                }
+
+                forEachListener(key, [&](Listener* l) {
+                    if (l->m_batchIndex == NoBatchIndex)
+                    {
+                        l->m_batchIndex = listeners.size();
+                        listeners.push_back(l->m_handle);
+                        if (keys.size() < listeners.size())
+                        {
+                            keys.emplace_back();
+                        }
+                        keys[l->m_batchIndex].clear();
+                    }
+                    keys[l->m_batchIndex].push_back(key);
+                    tally(key, &KeyStats::notifies);
+                });
+            }
+            m_originalsCount.fill(0u);
+
+            for (const auto& h : listeners)
+            {
+                resolve(h)->m_batchIndex = NoBatchIndex;
+            }
+
+            // Handles are resolved on every call, a listener may remove another one.
+            for (size_t i = 0; i < listeners.size(); i++)
+            {
+                if (auto* l = resolve(listeners[i]))
+                {
+                    traced(l, nullptr, keys[i].size(), [&] {
+                        l->onProfileBatch(keys[i]);
+                    });
+                }
+            }
+
+            pending.clear();
+            listeners.clear();
+            m_flushDepth--;
+        }
+
+        template <typename Enum, typename Value>
+        void notify(Enum e, const Value& value)
+        {
+            withStableValue<Enum>(value, [&](const detail::ValueOf<Enum>& stable) {
+                notify(makeKey(e), &onProfile<Enum>, &stable);
+            });
+        }
+
+        void notify(const Key& key, OnProfile call, const void* value)
+        {
+            DispatchScope scope(*this);
+            const auto& subscribers = m_subscribers[index(key.type)];
+            notifyList(subscribers.broadcast, key, call, value);
+            if (!subscribers.keys.empty())
+            {
+                notifyList(subscribers.keys[key.index], key, call, value);
+            }
+        }
+
+    protected:
+        // Every value value-initialized, read from a shared table until its first write.
+        explicit Profile()
+            : m_slots{}
+        {
+            publishAll();
+        }
+
+        // Every type starts as a copy of its array, which is kept for reset() and must
+        // outlive the profile, temporaries do not compile.
+        Profile(
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    detail::DefaultsRef<Type, Size> def##Name,
+
+            PROFILE_TYPES
+
+#undef PROFILE_TYPE
+
+            int dummy
+            = 0)
             :
 #define PROFILE_TYPE(Enum, Name, Type, Size) \
-    m_container##Name(def##Name),
+    m_container##Name(def##Name.values()),
 
             PROFILE_TYPES
 
 #undef PROFILE_TYPE
-            m_listeners{}
+            m_slots{}
         {
             (void)dummy;
+            publishAll();
+        }
+
+        explicit Profile(const Defaults& defaults)
+            : m_slots{}
+        {
+            forEachType([&](auto tag) {
+                container(tag).share(defaults.getValues(tag));
+            });
+
+            publishAll();
         }
 
     private:
-        uint32_t m_dirtyFlags = 0u;
+        DirtyTypes m_dirtyTypes;
+        KeyBits m_dirtyKeys;
 
 #define PROFILE_TYPE(Enum, Name, Type, Size) \
-    std::array<Type, Size> m_container##Name;
+    detail::Storage<Type, Size> m_container##Name;
 
         PROFILE_TYPES
 
 #undef PROFILE_TYPE
 
+#if defined(EASY_PROFILE_STATS)
+        mutable detail::KeyCounters<KeysCount> m_stats;
+#endif
+
+#if defined(EASY_PROFILE_TRACE)
+        Tracer* m_tracer = nullptr;
+#endif
+
+#if defined(EASY_PROFILE_CONCURRENT_READS)
+#    define PROFILE_TYPE(Enum, Name, Type, Size) \
+        detail::Mirror<Type, Size> m_mirror##Name;
+
+        PROFILE_TYPES
+
+#    undef PROFILE_TYPE
+#endif
+
+    private:
+        std::vector<Slot> m_slots;
+        std::vector<uint32_t> m_freeSlots;
+        size_t m_listenersCount = 0;
+        size_t m_entriesCount = 0;
+        size_t m_staleCount = 0;
+        uint32_t m_dispatchDepth = 0;
+        std::array<Subscribers, TypesCount> m_subscribers;
+
     private:
-        std::vector<Listener*> m_listeners;
+        uint32_t m_batchDepth = 0;
+        bool m_deferred = false;
+        std::vector<Key> m_pending;
+        std::deque<FlushScratch> m_flushScratch;
+        size_t m_flushDepth = 0;
+        KeyBits m_pendingKeys;
+        KeyBits m_capturedKeys;
+        Originals m_originals;
+        std::array<uint32_t, TypesCount> m_originalsCount{};
     };
 
 } // namespace easyprofile
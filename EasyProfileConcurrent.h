@@ -0,0 +1,356 @@
+/**********************************************\
+*
+*  Easy Profile library
+*  by Andrey A. Ugolnik
+*  https://github.com/reybits
+*
+\**********************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    include <immintrin.h>
+#endif
+
+#ifndef ASSERT
+#    ifndef NDEBUG
+#        include <cassert>
+#        define ASSERT(x) assert(x)
+#    else
+#        define ASSERT(x)
+#    endif
+#endif
+
+// Threads that may hold Pinned values at the same time.
+#ifndef EASY_PROFILE_MAX_READERS
+#    define EASY_PROFILE_MAX_READERS 128
+#endif
+
+namespace easyprofile
+{
+    template <typename Type>
+    class Pinned;
+
+    namespace detail
+    {
+        // Values stored as plain blocks of bytes: snapshots, seqlock mirrors.
+        template <typename Type>
+        inline constexpr bool IsBlock = std::is_trivially_copyable_v<Type>;
+
+        inline void cpuRelax()
+        {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+            _mm_pause();
+#elif defined(__aarch64__)
+            asm volatile("yield");
+#endif
+        }
+
+        // Copy of a container readable from any thread, written by the owner thread only.
+        // Every key has its own sequence counter, so readers of one key never retry because
+        // of writes to another, and a reader never blocks the writer. Values are copied as
+        // atomic words, which keeps torn reads defined. No fences, so TSAN understands it:
+        // a reader that sees any word of a new value also sees the odd sequence before it.
+        template <typename Type, size_t Size>
+        class SeqlockArray
+        {
+        public:
+            static constexpr size_t WordsCount = (sizeof(Type) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+            void store(size_t idx, const Type& value)
+            {
+                auto words = toWords(value);
+                auto& cell = m_cells[idx];
+
+                auto seq = cell.seq.load(std::memory_order_relaxed);
+                cell.seq.store(seq + 1, std::memory_order_relaxed);
+                for (size_t w = 0; w < WordsCount; w++)
+                {
+                    cell.words[w].store(words[w], std::memory_order_release);
+                }
+                cell.seq.store(seq + 2, std::memory_order_release);
+            }
+
+            Type load(size_t idx) const
+            {
+                const auto& cell = m_cells[idx];
+                std::array<uint64_t, WordsCount> words;
+
+                while (true)
+                {
+                    auto seq = cell.seq.load(std::memory_order_acquire);
+                    if ((seq & 1u) == 0u)
+                    {
+                        for (size_t w = 0; w < WordsCount; w++)
+                        {
+                            words[w] = cell.words[w].load(std::memory_order_acquire);
+                        }
+                        if (cell.seq.load(std::memory_order_relaxed) == seq)
+                        {
+                            return fromWords(words);
+                        }
+                    }
+                    cpuRelax();
+                }
+            }
+
+        private:
+            static std::array<uint64_t, WordsCount> toWords(const Type& value)
+            {
+                std::array<uint64_t, WordsCount> words{};
+                std::memcpy(words.data(), &value, sizeof(Type));
+                return words;
+            }
+
+            static Type fromWords(const std::array<uint64_t, WordsCount>& words)
+            {
+                std::array<std::byte, sizeof(Type)> bytes;
+                std::memcpy(bytes.data(), words.data(), sizeof(Type));
+                return std::bit_cast<Type>(bytes);
+            }
+
+        private:
+            struct Cell
+            {
+                std::atomic<uint32_t> seq{ 0u };
+                std::array<std::atomic<uint64_t>, WordsCount> words{};
+            };
+
+            std::array<Cell, Size> m_cells;
+        };
+
+        // Epoch based reclamation shared by all profiles.
+        //
+        // A reader announces the global epoch in its own slot before loading a pointer and
+        // clears the slot when done, both wait-free. The writer retires a replaced version
+        // with the epoch it was replaced in and deletes it once every announced epoch is newer.
+        class EpochDomain final
+        {
+        public:
+            static constexpr size_t MaxReaders = EASY_PROFILE_MAX_READERS;
+            static constexpr uint64_t Inactive = std::numeric_limits<uint64_t>::max();
+
+            static EpochDomain& instance()
+            {
+                static EpochDomain domain;
+                return domain;
+            }
+
+            void enter()
+            {
+                auto& state = threadState();
+                if (state.depth++ == 0)
+                {
+                    m_slots[state.slot].epoch.store(m_epoch.load());
+                }
+            }
+
+            void leave()
+            {
+                auto& state = threadState();
+                ASSERT(state.depth != 0);
+                if (--state.depth == 0)
+                {
+                    m_slots[state.slot].epoch.store(Inactive, std::memory_order_release);
+                }
+            }
+
+            // Called after a version was unlinked, returns the epoch it must outlive.
+            uint64_t retire()
+            {
+                return m_epoch.fetch_add(1);
+            }
+
+            // Versions retired before this epoch are not reachable by any reader.
+            uint64_t safeEpoch() const
+            {
+                auto result = Inactive;
+                for (const auto& slot : m_slots)
+                {
+                    result = std::min(result, slot.epoch.load());
+                }
+                return result;
+            }
+
+        private:
+            struct alignas(64) Slot
+            {
+                std::atomic<bool> used{ false };
+                std::atomic<uint64_t> epoch{ Inactive };
+            };
+
+            struct ThreadState
+            {
+                size_t slot;
+                uint32_t depth = 0;
+
+                ~ThreadState()
+                {
+                    instance().m_slots[slot].used.store(false, std::memory_order_release);
+                }
+            };
+
+            ThreadState& threadState()
+            {
+                thread_local ThreadState state{ claim() };
+                return state;
+            }
+
+            // Waits for a free slot if more than MaxReaders threads read at once.
+            size_t claim()
+            {
+                while (true)
+                {
+                    for (size_t i = 0; i < MaxReaders; i++)
+                    {
+                        bool expected = false;
+                        if (m_slots[i].used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                        {
+                            return i;
+                        }
+                    }
+                    ASSERT(false && "EASY_PROFILE_MAX_READERS exceeded");
+                    cpuRelax();
+                }
+            }
+
+        private:
+            std::atomic<uint64_t> m_epoch{ 0u };
+            std::array<Slot, MaxReaders> m_slots;
+        };
+
+        // Read-copy-update mirror for values that can't be copied word by word.
+        // Every key points to an immutable version; store() publishes a new one and
+        // retires the old, readers pin the version they loaded.
+        template <typename Type, size_t Size>
+        class RcuArray
+        {
+        public:
+            static constexpr size_t ReclaimThreshold = 64;
+
+            RcuArray() = default;
+
+            ~RcuArray()
+            {
+                for (auto& version : m_versions)
+                {
+                    delete version.load(std::memory_order_relaxed);
+                }
+                for (auto& retired : m_retired)
+                {
+                    delete retired.first;
+                }
+            }
+
+            template <typename Value>
+            void store(size_t idx, const Value& value)
+            {
+                const auto* old = m_versions[idx].exchange(new Type(value));
+                if (old != nullptr)
+                {
+                    m_retired.emplace_back(old, EpochDomain::instance().retire());
+                    if (m_retired.size() >= ReclaimThreshold)
+                    {
+                        reclaim();
+                    }
+                }
+            }
+
+            Pinned<Type> pin(size_t idx) const
+            {
+                EpochDomain::instance().enter();
+                return Pinned<Type>(m_versions[idx].load());
+            }
+
+            Type load(size_t idx) const
+            {
+                return *pin(idx);
+            }
+
+        private:
+            RcuArray(const RcuArray&) = delete;
+            RcuArray& operator=(const RcuArray&) = delete;
+
+            void reclaim()
+            {
+                auto safeEpoch = EpochDomain::instance().safeEpoch();
+                std::erase_if(m_retired, [safeEpoch](const auto& retired) {
+                    if (retired.second < safeEpoch)
+                    {
+                        delete retired.first;
+                        return true;
+                    }
+                    return false;
+                });
+            }
+
+        private:
+            std::array<std::atomic<const Type*>, Size> m_versions{};
+            std::vector<std::pair<const Type*, uint64_t>> m_retired;
+        };
+
+        template <typename Type, size_t Size>
+        using Mirror = std::conditional_t<IsBlock<Type>, SeqlockArray<Type, Size>, RcuArray<Type, Size>>;
+
+    } // namespace detail
+
+    // Immutable version of a value returned by Profile::pin(). It stays valid, whatever the
+    // owner thread sets meanwhile, until the handle is destroyed on the thread that pinned it.
+    template <typename Type>
+    class Pinned final
+    {
+    public:
+        Pinned(Pinned&& other)
+            : m_value(other.m_value)
+            , m_pinned(std::exchange(other.m_pinned, false))
+        {
+        }
+
+        ~Pinned()
+        {
+            if (m_pinned)
+            {
+                detail::EpochDomain::instance().leave();
+            }
+        }
+
+        const Type& operator*() const
+        {
+            return *m_value;
+        }
+
+        const Type* operator->() const
+        {
+            return m_value;
+        }
+
+    private:
+        template <typename, size_t>
+        friend class detail::RcuArray;
+
+        explicit Pinned(const Type* value)
+            : m_value(value)
+        {
+        }
+
+        Pinned(const Pinned&) = delete;
+        Pinned& operator=(const Pinned&) = delete;
+        Pinned& operator=(Pinned&&) = delete;
+
+        const Type* m_value;
+        bool m_pinned = true;
+    };
+
+} // namespace easyprofile
@@ -0,0 +1,378 @@
+/**********************************************\
+*
+*  Easy Profile library
+*  by Andrey A. Ugolnik
+*  https://github.com/reybits
+*
+\**********************************************/
+
+/**********************************************\
+* Usage:
+```cpp
+#include "EasyProfile.h"
+#include "EasyProfileJournal.h"
+
+easyprofile::Journal journal("settings");
+journal.open(myProfile);    // settings.snap + settings.log
+
+myProfile.set(U32::ValueOne, 42u);
+journal.append(myProfile);  // one record with the dirty keys
+```
+\**********************************************/
+
+#pragma once
+
+#include "EasyProfile.h"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#if defined(_WIN32)
+#    include <io.h>
+#else
+#    include <unistd.h>
+#endif
+
+namespace easyprofile
+{
+    // Append-only log of dirty keys on top of a snapshot file.
+    //
+    // Every append() writes the dirty keys as one record guarded by a checksum, so a record
+    // torn by a crash is dropped as a whole on replay. Records hold full values. Compaction
+    // writes the snapshot on a background thread and cuts the log afterwards, with appends
+    // going on meanwhile. Until the cut, recovery replays the whole log over the new snapshot,
+    // which is only right if the snapshot holds nothing newer than the log: a value set but
+    // not yet appended would be overwritten by an older record. So a snapshot is only taken
+    // of a clean profile, whose state is exactly the one the log ends with.
+    class Journal final
+    {
+    public:
+        static constexpr uint32_t Magic = 0x4a505a45u; // "EZPJ"
+        static constexpr uint32_t Version = 2u; // 2: records carry value kinds.
+        static constexpr size_t HeaderSize = 8;
+        static constexpr size_t RecordHeaderSize = 8;
+
+        explicit Journal(std::string basePath, size_t compactThreshold = 1u << 20)
+            : m_snapshotPath(basePath + ".snap")
+            , m_logPath(basePath + ".log")
+            , m_compactThreshold(compactThreshold)
+        {
+        }
+
+        ~Journal()
+        {
+            waitCompaction();
+            close();
+        }
+
+        // Loads the snapshot, replays the log and opens it for appending. Values of a missing
+        // or unreadable snapshot stay as they are. Returns false if the log can't be opened.
+        bool open(Profile& profile)
+        {
+            waitCompaction();
+            close();
+
+            std::vector<std::byte> bytes;
+            if (readFile(m_snapshotPath, 0, bytes))
+            {
+                profile.load(bytes);
+            }
+
+            readFile(m_logPath, 0, bytes);
+            auto logSize = replay(profile, bytes);
+            if (logSize == 0)
+            {
+                bytes.clear();
+                appendHeader(bytes);
+                logSize = bytes.size();
+                if (!writeFile(m_logPath, bytes))
+                {
+                    return false;
+                }
+            }
+
+            // Reopening cuts a torn tail, the next record must follow the last valid one.
+            return reopen(logSize);
+        }
+
+        // Writes dirty keys of the profile as one durable record and marks them clean.
+        // Starts a background compaction once the log outgrows the threshold.
+        bool append(Profile& profile)
+        {
+            finishCompaction();
+
+            if (m_file == nullptr)
+            {
+                return false;
+            }
+            if (!profile.isDirty())
+            {
+                return true;
+            }
+
+            m_record.clear();
+            profile.saveDirty(m_record);
+            if (!appendRecord(m_record.data()))
+            {
+                return false;
+            }
+            profile.resetDirty();
+
+            if (needsCompaction())
+            {
+                compact(profile);
+            }
+            return true;
+        }
+
+        // Appends a payload written by Profile::saveDirty() as one durable record.
+        // Doesn't touch the profile, so it may run on another thread (see PersistenceWorker).
+        bool append(std::span<const std::byte> payload)
+        {
+            finishCompaction();
+            return m_file != nullptr && appendRecord(payload);
+        }
+
+        bool needsCompaction() const
+        {
+            return m_logSize >= m_compactThreshold;
+        }
+
+        // Serializes the profile now, writes the snapshot file on a background thread.
+        // Does nothing while the profile has dirty keys, append them first. Returns true if
+        // a compaction was started.
+        bool compact(const Profile& profile)
+        {
+            if (m_compaction.joinable() || profile.isDirty())
+            {
+                return false;
+            }
+
+            VectorWriter writer;
+            profile.save(writer);
+
+            m_compactOffset = m_logSize;
+            m_compacted = false;
+            m_compaction = std::thread([this, writer = std::move(writer)] {
+                m_compactResult = writeFile(m_snapshotPath, writer.data());
+                m_compacted = true;
+            });
+            return true;
+        }
+
+        // Blocks until a running compaction is done and the log is cut.
+        void waitCompaction()
+        {
+            if (m_compaction.joinable())
+            {
+                m_compaction.join();
+                m_compacted = true;
+                finishCompaction();
+            }
+        }
+
+        size_t getLogSize() const
+        {
+            return m_logSize;
+        }
+
+        // Applies every complete record of a log and returns the size of the valid prefix.
+        static size_t replay(Profile& profile, std::span<const std::byte> log)
+        {
+            if (log.size() < HeaderSize)
+            {
+                return 0;
+            }
+
+            std::array<uint32_t, 2> header;
+            snapshot::readValues(log.data(), header.data(), header.size());
+            if (header[0] != Magic || header[1] == 0u || header[1] > Version)
+            {
+                return 0;
+            }
+
+            size_t offset = HeaderSize;
+            while (log.size() - offset >= RecordHeaderSize)
+            {
+                std::array<uint32_t, 2> record; // payload size, checksum
+                snapshot::readValues(log.data() + offset, record.data(), record.size());
+                if (record[0] > log.size() - offset - RecordHeaderSize)
+                {
+                    break;
+                }
+
+                auto payload = log.subspan(offset + RecordHeaderSize, record[0]);
+                if (snapshot::checksum(payload) != record[1] || !profile.loadDirty(payload))
+                {
+                    break;
+                }
+                offset += RecordHeaderSize + record[0];
+            }
+            return offset;
+        }
+
+    private:
+        Journal(const Journal&) = delete;
+        Journal& operator=(const Journal&) = delete;
+
+        static void appendHeader(std::vector<std::byte>& bytes)
+        {
+            VectorWriter writer;
+            std::array<uint32_t, 2> header{ Magic, Version };
+            snapshot::writeValues(writer, header.data(), header.size());
+            bytes.insert(bytes.end(), writer.data().begin(), writer.data().end());
+        }
+
+        bool appendRecord(std::span<const std::byte> payload)
+        {
+            std::array<uint32_t, 2> header{ static_cast<uint32_t>(payload.size()), snapshot::checksum(payload) };
+            m_frame.clear();
+            snapshot::writeValues(m_frame, header.data(), header.size());
+            m_frame.write(payload);
+
+            const auto& frame = m_frame.data();
+            if (std::fwrite(frame.data(), 1, frame.size(), m_file) != frame.size() || !sync(m_file))
+            {
+                // Whatever reached the file is a torn record, cut it off.
+                close();
+                reopen(m_logSize);
+                return false;
+            }
+            m_logSize += frame.size();
+            return true;
+        }
+
+        // Cuts the log to the records written after the snapshot was taken.
+        void finishCompaction()
+        {
+            if (!m_compacted)
+            {
+                return;
+            }
+            if (m_compaction.joinable())
+            {
+                m_compaction.join();
+            }
+            m_compacted = false;
+
+            std::vector<std::byte> tail;
+            if (!m_compactResult || !readFile(m_logPath, m_compactOffset, tail))
+            {
+                return;
+            }
+
+            std::vector<std::byte> bytes;
+            appendHeader(bytes);
+            bytes.insert(bytes.end(), tail.begin(), tail.end());
+
+            close();
+            if (writeFile(m_logPath, bytes))
+            {
+                reopen(bytes.size());
+            }
+            else
+            {
+                reopen(m_logSize);
+            }
+        }
+
+        bool reopen(size_t logSize)
+        {
+            std::error_code ec;
+            std::filesystem::resize_file(m_logPath, logSize, ec);
+            m_file = ec ? nullptr : std::fopen(m_logPath.c_str(), "ab");
+            m_logSize = logSize;
+            return m_file != nullptr;
+        }
+
+        void close()
+        {
+            if (m_file != nullptr)
+            {
+                std::fclose(m_file);
+                m_file = nullptr;
+            }
+        }
+
+        static bool sync(std::FILE* file)
+        {
+            if (std::fflush(file) != 0)
+            {
+                return false;
+            }
+#if defined(_WIN32)
+            return ::_commit(::_fileno(file)) == 0;
+#else
+            return ::fsync(::fileno(file)) == 0;
+#endif
+        }
+
+        static bool readFile(const std::string& path, size_t offset, std::vector<std::byte>& bytes)
+        {
+            bytes.clear();
+            auto* file = std::fopen(path.c_str(), "rb");
+            if (file == nullptr)
+            {
+                return false;
+            }
+
+            bool result = std::fseek(file, 0, SEEK_END) == 0;
+            auto size = result ? std::ftell(file) : -1;
+            result = size >= 0 && static_cast<size_t>(size) >= offset
+                && std::fseek(file, static_cast<long>(offset), SEEK_SET) == 0;
+            if (result)
+            {
+                bytes.resize(static_cast<size_t>(size) - offset);
+                result = std::fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+            }
+            std::fclose(file);
+            return result;
+        }
+
+        // Writes a temporary file and renames it over path, readers see the old or the new file.
+        static bool writeFile(const std::string& path, std::span<const std::byte> bytes)
+        {
+            auto tmpPath = path + ".tmp";
+            auto* file = std::fopen(tmpPath.c_str(), "wb");
+            if (file == nullptr)
+            {
+                return false;
+            }
+
+            bool result = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size() && sync(file);
+            std::fclose(file);
+
+            std::error_code ec;
+            if (result)
+            {
+                std::filesystem::rename(tmpPath, path, ec);
+            }
+            if (!result || ec)
+            {
+                std::filesystem::remove(tmpPath, ec);
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        std::string m_snapshotPath;
+        std::string m_logPath;
+        size_t m_compactThreshold;
+
+        std::FILE* m_file = nullptr;
+        size_t m_logSize = 0;
+        VectorWriter m_record;
+        VectorWriter m_frame;
+
+        std::thread m_compaction;
+        std::atomic<bool> m_compacted = false;
+        bool m_compactResult = false;
+        size_t m_compactOffset = 0;
+    };
+
+} // namespace easyprofile
@@ -0,0 +1,244 @@
+/**********************************************\
+*
+*  Easy Profile library
+*  by Andrey A. Ugolnik
+*  https://github.com/reybits
+*
+\**********************************************/
+
+/**********************************************\
+* Usage:
+```cpp
+#include "EasyProfileKeys.h"
+
+#define U32_KEYS(KEY) \
+    KEY(One)          \
+    KEY(Two)
+
+PROFILE_ENUM(U32, U32_KEYS)
+
+static_assert(easyprofile::getName(U32::Two) == "Two");
+static_assert(easyprofile::findKey<U32>("One") == U32::One);
+```
+\**********************************************/
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Enums with more keys build their name index once at first lookup instead of at compile
+// time, GCC's constant evaluator needs about a second per 2000 keys.
+#ifndef EASY_PROFILE_CONSTEXPR_INDEX_LIMIT
+#    define EASY_PROFILE_CONSTEXPR_INDEX_LIMIT 1024
+#endif
+
+#define PROFILE_KEY_ENUMERATOR(Key) Key,
+#define PROFILE_KEY_NAME(Key) std::string_view{ #Key },
+
+// Declares `enum class Enum { keys..., Count }` and a constexpr table of key names
+// from an X-macro list of keys.
+#define PROFILE_ENUM(Enum, KEYS)                                             \
+    enum class Enum                                                          \
+    {                                                                        \
+        KEYS(PROFILE_KEY_ENUMERATOR)                                         \
+                                                                             \
+        Count                                                                \
+    };                                                                       \
+                                                                             \
+    constexpr std::array<std::string_view, static_cast<size_t>(Enum::Count)> \
+    profileKeyNames(Enum)                                                    \
+    {                                                                        \
+        return { KEYS(PROFILE_KEY_NAME) };                                   \
+    }
+
+namespace easyprofile
+{
+    namespace detail
+    {
+        constexpr uint64_t hashName(std::string_view name)
+        {
+            // FNV-1a, 64 bit.
+            uint64_t h = 14695981039346656037ull;
+            for (char c : name)
+            {
+                h ^= static_cast<uint8_t>(c);
+                h *= 1099511628211ull;
+            }
+            return h;
+        }
+
+        constexpr uint32_t mixSeed(uint64_t hash, uint32_t seed)
+        {
+            // Murmur3 finalizer over the low half displaced by the seed.
+            auto h = static_cast<uint32_t>(hash) + seed * 0x9e3779b9u;
+            h ^= h >> 16;
+            h *= 0x85ebca6bu;
+            h ^= h >> 13;
+            h *= 0xc2b2ae35u;
+            h ^= h >> 16;
+            return h;
+        }
+
+        // "Hash and displace" perfect hash over N distinct names, built at compile time.
+        // Each name is hashed once: the high half picks a bucket, then every bucket, largest
+        // first, gets the first seed that maps all its keys to free slots of a half empty table.
+        template <size_t N>
+        class PerfectHash
+        {
+        public:
+            static constexpr size_t BucketsCount = N / 2 + 1;
+            static constexpr size_t TableSize = std::bit_ceil(2 * N + 1);
+            static constexpr uint32_t Empty = UINT32_MAX;
+
+            constexpr explicit PerfectHash(const std::array<std::string_view, N>& names)
+            {
+                m_slots.fill(Empty);
+
+                // Scratch buffers live on the heap, the index may also be built at run time.
+                std::vector<uint64_t> hashes(N);
+                for (size_t i = 0; i < N; i++)
+                {
+                    hashes[i] = hashName(names[i]);
+                }
+
+                // Counting sort of keys by bucket.
+                std::vector<uint32_t> start(BucketsCount + 1);
+                for (auto hash : hashes)
+                {
+                    start[bucketOf(hash) + 1]++;
+                }
+                size_t maxSize = 0;
+                for (size_t b = 0; b < BucketsCount; b++)
+                {
+                    maxSize = start[b + 1] > maxSize ? start[b + 1] : maxSize;
+                    start[b + 1] += start[b];
+                }
+
+                std::vector<uint32_t> keys(N);
+                auto fill = start;
+                for (size_t i = 0; i < N; i++)
+                {
+                    keys[fill[bucketOf(hashes[i])]++] = static_cast<uint32_t>(i);
+                }
+
+                // Place buckets from the largest, they are the hardest to fit.
+                for (size_t size = maxSize; size > 0; size--)
+                {
+                    for (size_t b = 0; b < BucketsCount; b++)
+                    {
+                        if (start[b + 1] - start[b] == size)
+                        {
+                            place(hashes, b, &keys[start[b]], size);
+                        }
+                    }
+                }
+            }
+
+            // Returns the key index or Empty.
+            constexpr uint32_t find(const std::array<std::string_view, N>& names, std::string_view name) const
+            {
+                auto hash = hashName(name);
+                auto idx = m_slots[slotOf(hash, m_seeds[bucketOf(hash)])];
+                return idx != Empty && names[idx] == name ? idx : Empty;
+            }
+
+        private:
+            static constexpr size_t bucketOf(uint64_t hash)
+            {
+                return static_cast<size_t>(hash >> 32) % BucketsCount;
+            }
+
+            static constexpr size_t slotOf(uint64_t hash, uint32_t seed)
+            {
+                return mixSeed(hash, seed) & (TableSize - 1);
+            }
+
+            constexpr void place(const std::vector<uint64_t>& hashes, size_t bucket, const uint32_t* keys, size_t size)
+            {
+                for (uint32_t seed = 1;; seed++)
+                {
+                    bool fits = true;
+                    for (size_t i = 0; i < size && fits; i++)
+                    {
+                        auto slot = slotOf(hashes[keys[i]], seed);
+                        fits = m_slots[slot] == Empty;
+                        for (size_t j = 0; j < i && fits; j++)
+                        {
+                            fits = slotOf(hashes[keys[j]], seed) != slot;
+                        }
+                    }
+
+                    if (fits)
+                    {
+                        m_seeds[bucket] = seed;
+                        for (size_t i = 0; i < size; i++)
+                        {
+                            m_slots[slotOf(hashes[keys[i]], seed)] = keys[i];
+                        }
+                        return;
+                    }
+                }
+            }
+
+        private:
+            std::array<uint32_t, BucketsCount> m_seeds{};
+            std::array<uint32_t, TableSize> m_slots{};
+        };
+
+        template <typename Enum>
+        concept NamedEnum = requires { profileKeyNames(Enum{}); };
+
+        template <NamedEnum Enum>
+        inline constexpr auto KeyNames = profileKeyNames(Enum{});
+
+        template <NamedEnum Enum>
+        using KeyIndexType = PerfectHash<static_cast<size_t>(Enum::Count)>;
+
+        template <NamedEnum Enum>
+        inline constexpr auto KeyIndex = KeyIndexType<Enum>(KeyNames<Enum>);
+
+        template <NamedEnum Enum>
+        const KeyIndexType<Enum>& runtimeKeyIndex()
+        {
+            static const KeyIndexType<Enum> index(KeyNames<Enum>);
+            return index;
+        }
+
+    } // namespace detail
+
+    // Name of a key declared with PROFILE_ENUM.
+    template <detail::NamedEnum Enum>
+    constexpr std::string_view getName(Enum e)
+    {
+        return detail::KeyNames<Enum>[static_cast<size_t>(e)];
+    }
+
+    // Key of a PROFILE_ENUM type by name, one hash probe and one string compare.
+    // Usable in constant expressions up to EASY_PROFILE_CONSTEXPR_INDEX_LIMIT keys.
+    template <detail::NamedEnum Enum>
+    constexpr std::optional<Enum> findKey(std::string_view name)
+    {
+        uint32_t idx;
+        if constexpr (static_cast<size_t>(Enum::Count) <= EASY_PROFILE_CONSTEXPR_INDEX_LIMIT)
+        {
+            idx = detail::KeyIndex<Enum>.find(detail::KeyNames<Enum>, name);
+        }
+        else
+        {
+            idx = detail::runtimeKeyIndex<Enum>().find(detail::KeyNames<Enum>, name);
+        }
+
+        if (idx == detail::KeyIndexType<Enum>::Empty)
+        {
+            return std::nullopt;
+        }
+        return static_cast<Enum>(idx);
+    }
+
+} // namespace easyprofile
@@ -0,0 +1,240 @@
+/**********************************************\
+*
+*  Easy Profile library
+*  by Andrey A. Ugolnik
+*  https://github.com/reybits
+*
+\**********************************************/
+
+/**********************************************\
+* Usage:
+```cpp
+#include "EasyProfile.h"
+#include "EasyProfilePersistence.h"
+
+easyprofile::Journal journal("settings");
+journal.open(myProfile);
+
+easyprofile::PersistenceWorker worker(myProfile, journal);
+
+// Once per frame, never blocks on I/O.
+worker.update();
+```
+\**********************************************/
+
+#pragma once
+
+#include "EasyProfileJournal.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace easyprofile
+{
+    // Persists dirty keys of a profile to a journal from a dedicated thread.
+    //
+    // update() runs on the thread that owns the profile: it copies the dirty values, takes
+    // their dirty bits and hands the record to the worker thread, which does the write and
+    // fsync. Keys set meanwhile are dirty again and go with the next flush, keys of a failed
+    // write are marked dirty again. A flush starts no sooner than `delay` after the profile
+    // became dirty, so a burst of set() calls ends up in one record. The journal is compacted
+    // only once a write is collected and no key is dirty (see Journal::compact()).
+    class PersistenceWorker final
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        PersistenceWorker(Profile& profile, Journal& journal, Clock::duration delay = std::chrono::milliseconds(100))
+            : m_profile(profile)
+            , m_journal(journal)
+            , m_delay(delay)
+            , m_thread([this] {
+                run();
+            })
+        {
+        }
+
+        ~PersistenceWorker()
+        {
+            flush();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_one();
+            m_thread.join();
+        }
+
+        // Collects a finished write and starts the next one when it's due.
+        void update()
+        {
+            update(Clock::now(), false);
+        }
+
+        // Writes all dirty keys now and waits for the result.
+        bool flush()
+        {
+            wait();
+            if (!m_profile.isDirty())
+            {
+                return true;
+            }
+            update(Clock::now(), true);
+            wait();
+            return m_lastResult;
+        }
+
+        size_t getWritesCount() const
+        {
+            return m_writesCount;
+        }
+
+    private:
+        PersistenceWorker(const PersistenceWorker&) = delete;
+        PersistenceWorker& operator=(const PersistenceWorker&) = delete;
+
+        enum class State
+        {
+            Idle,
+            Writing,
+            Done,
+        };
+
+        void update(Clock::time_point now, bool force)
+        {
+            State state;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                state = m_state;
+            }
+
+            if (state == State::Writing)
+            {
+                return;
+            }
+            if (state == State::Done)
+            {
+                finish();
+            }
+
+            if (!m_profile.isDirty())
+            {
+                m_dueTime.reset();
+                compact();
+                return;
+            }
+            if (!m_dueTime)
+            {
+                m_dueTime = now + m_delay;
+            }
+
+            if (force || now >= *m_dueTime)
+            {
+                m_dueTime.reset();
+                start();
+            }
+        }
+
+        void start()
+        {
+            m_record.clear();
+            m_profile.saveDirty(m_record);
+            m_written = m_profile.takeDirty();
+
+            // The journal is left to the worker until the write is collected.
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_state = State::Writing;
+            }
+            m_wake.notify_one();
+        }
+
+        void finish()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_state = State::Idle;
+            }
+
+            m_writesCount++;
+            if (!m_lastResult)
+            {
+                m_profile.restoreDirty(m_written);
+            }
+            compact();
+        }
+
+        // Keys set since the write was started are not in the log yet, the snapshot waits
+        // for the next time the profile is clean.
+        void compact()
+        {
+            if (m_journal.needsCompaction() && !m_profile.isDirty())
+            {
+                m_journal.compact(m_profile);
+            }
+        }
+
+        // Blocks until the current write, if any, is collected.
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this] {
+                return m_state != State::Writing;
+            });
+            auto done = m_state == State::Done;
+            lock.unlock();
+
+            if (done)
+            {
+                finish();
+            }
+        }
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (true)
+            {
+                m_wake.wait(lock, [this] {
+                    return m_stop || m_state == State::Writing;
+                });
+                if (m_state != State::Writing)
+                {
+                    return;
+                }
+
+                lock.unlock();
+                auto result = m_journal.append(m_record.data());
+                lock.lock();
+
+                m_lastResult = result;
+                m_state = State::Done;
+                m_done.notify_all();
+            }
+        }
+
+    private:
+        Profile& m_profile;
+        Journal& m_journal;
+        Clock::duration m_delay;
+
+        std::optional<Clock::time_point> m_dueTime;
+        VectorWriter m_record;
+        Profile::DirtySet m_written;
+        size_t m_writesCount = 0;
+        bool m_lastResult = true;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        State m_state = State::Idle;
+        bool m_stop = false;
+
+        std::thread m_thread;
+    };
+
+} // namespace easyprofile
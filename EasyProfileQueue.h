@@ -0,0 +1,183 @@
+/**********************************************\
+*
+*  Easy Profile library
+*  by Andrey A. Ugolnik
+*  https://github.com/reybits
+*
+\**********************************************/
+
+/**********************************************\
+* Usage:
+```cpp
+#include "EasyProfile.h"
+#include "EasyProfileQueue.h"
+
+easyprofile::ChangeQueue queue(myProfile, 1024);
+
+// Any thread.
+queue.post(U32::ValueOne, 42u);
+
+// Owner thread, e.g. once per frame.
+queue.drain();
+```
+\**********************************************/
+
+#pragma once
+
+#include "EasyProfile.h"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <variant>
+
+namespace easyprofile
+{
+    namespace detail
+    {
+        // std::monostate marks an empty cell, PROFILE_TYPEs follow in order.
+        using ChangeValue = std::variant<std::monostate
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    , Type
+                                         PROFILE_TYPES
+#undef PROFILE_TYPE
+                                         >;
+
+        constexpr size_t changeValueIndex(Profile::DirtyBitIndex type)
+        {
+            return static_cast<size_t>(type) + 1;
+        }
+
+    } // namespace detail
+
+    // Bounded lock-free multi-producer queue of set() requests in front of a Profile.
+    //
+    // Any thread may post(), the owner thread of the profile calls drain(), which applies
+    // queued values in order through set() inside one Batch: unchanged values are skipped
+    // and listeners get a single onProfileBatch() for the whole drain.
+    class ChangeQueue final
+    {
+    public:
+        // Capacity is rounded up to a power of two.
+        explicit ChangeQueue(Profile& profile, size_t capacity = 1024)
+            : m_profile(profile)
+            , m_mask(std::bit_ceil(capacity < 2 ? size_t{ 2 } : capacity) - 1)
+            , m_cells(std::make_unique<Cell[]>(m_mask + 1))
+        {
+            for (size_t i = 0; i <= m_mask; i++)
+            {
+                m_cells[i].seq.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        // Queues a change, returns false if the queue is full.
+        template <detail::ProfileKey Enum>
+        bool post(Enum e, detail::ValueOf<Enum> value)
+        {
+            constexpr auto type = detail::ProfileType<Enum>::Index;
+            return push(type, static_cast<uint32_t>(e), [&](auto& slot) {
+                slot.template emplace<detail::changeValueIndex(type)>(std::move(value));
+            });
+        }
+
+        // Applies up to maxCount queued changes, returns how many were applied.
+        size_t drain(size_t maxCount = SIZE_MAX)
+        {
+            Profile::Batch batch(m_profile);
+
+            size_t count = 0;
+            for (; count < maxCount; count++)
+            {
+                auto& cell = m_cells[m_head & m_mask];
+                if (cell.seq.load(std::memory_order_acquire) != m_head + 1)
+                {
+                    break;
+                }
+
+                apply(cell);
+                cell.value.emplace<0>();
+                cell.seq.store(m_head + m_mask + 1, std::memory_order_release);
+                m_head++;
+            }
+            return count;
+        }
+
+    private:
+        ChangeQueue(const ChangeQueue&) = delete;
+        ChangeQueue& operator=(const ChangeQueue&) = delete;
+
+        // Cell of a Vyukov bounded queue: seq == position when free for the producer
+        // of that position, position + 1 when filled for the consumer.
+        struct alignas(64) Cell
+        {
+            std::atomic<size_t> seq;
+            Profile::DirtyBitIndex type;
+            uint32_t index;
+            detail::ChangeValue value;
+        };
+
+        template <typename Fill>
+        bool push(Profile::DirtyBitIndex type, uint32_t index, Fill&& fill)
+        {
+            auto pos = m_tail.load(std::memory_order_relaxed);
+            while (true)
+            {
+                auto& cell = m_cells[pos & m_mask];
+                auto seq = cell.seq.load(std::memory_order_acquire);
+                auto diff = static_cast<std::make_signed_t<size_t>>(seq - pos);
+                if (diff == 0)
+                {
+                    if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        cell.type = type;
+                        cell.index = index;
+                        fill(cell.value);
+                        cell.seq.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // The one place a queued type index turns back into its key enum. Types may share
+        // a value type, so the variant alone can't tell them apart.
+        void apply(Cell& cell)
+        {
+            switch (cell.type)
+            {
+#define PROFILE_TYPE(Enum, Name, Type, Size)                                                                    \
+    case Profile::DirtyBitIndex::Name:                                                                          \
+        m_profile.set(static_cast<Enum>(cell.index),                                                            \
+                      std::move(std::get<detail::changeValueIndex(Profile::DirtyBitIndex::Name)>(cell.value))); \
+        break;
+
+                PROFILE_TYPES
+
+#undef PROFILE_TYPE
+
+            case Profile::DirtyBitIndex::Count:
+                break;
+            }
+        }
+
+    private:
+        Profile& m_profile;
+        size_t m_mask;
+        std::unique_ptr<Cell[]> m_cells;
+
+        alignas(64) std::atomic<size_t> m_tail{ 0u };
+        alignas(64) size_t m_head = 0;
+    };
+
+} // namespace easyprofile
@@ -0,0 +1,593 @@
+/**********************************************\
+*
+*  Easy Profile library
+*  by Andrey A. Ugolnik
+*  https://github.com/reybits
+*
+\**********************************************/
+
+/**********************************************\
+* Snapshot layout, all fields little-endian:
+*
+*   FileHeader     magic, version, sections count
+*   Section...     SectionHeader followed by payload
+*
+* A section header records the kind of its values
+* (bool, signed, unsigned, float, string or raw
+* bytes), so a type that keeps its size but changes
+* its kind is rejected.
+*
+* Payload of a Block section is `count` values of
+* `elementSize` bytes each. Payload of a Strings
+* section is `count` u32 lengths followed by the
+* concatenated characters. Every section starts at
+* an 8 byte aligned offset, so blocks can be used
+* in place from an mmap()ed file.
+*
+* Dirty keys are written as a plain list of entries:
+*
+*   u64 type hash, u32 key index (low 24 bits) and
+*   value kind (high 8 bits), u32 value size, value
+*   bytes (a block value or string characters)
+*
+* Version 1 had no kinds, its values are checked by
+* size only.
+\**********************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace easyprofile
+{
+    // Byte sink for Profile::save().
+    class Writer
+    {
+    public:
+        virtual ~Writer() = default;
+
+        virtual void write(std::span<const std::byte> bytes) = 0;
+    };
+
+    class VectorWriter final : public Writer
+    {
+    public:
+        void write(std::span<const std::byte> bytes) override
+        {
+            m_data.insert(m_data.end(), bytes.begin(), bytes.end());
+        }
+
+        const std::vector<std::byte>& data() const
+        {
+            return m_data;
+        }
+
+        void clear()
+        {
+            m_data.clear();
+        }
+
+    private:
+        std::vector<std::byte> m_data;
+    };
+
+    namespace snapshot
+    {
+        static constexpr uint32_t Magic = 0x46505a45u; // "EZPF"
+        static constexpr uint32_t Version = 2u;
+        static constexpr size_t Alignment = 8;
+
+        enum class Encoding : uint32_t
+        {
+            Block,
+            Strings,
+        };
+
+        enum class Kind : uint32_t
+        {
+            Untagged, // Written by version 1.
+            Bool,
+            Signed,
+            Unsigned,
+            Float,
+            String,
+            Raw,
+        };
+
+        struct FileHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t sectionsCount;
+            uint32_t reserved;
+        };
+
+        struct SectionHeader
+        {
+            uint64_t typeHash; // Hash of the PROFILE_TYPE name.
+            Encoding encoding;
+            uint32_t elementSize;
+            uint32_t count;
+            Kind kind;
+            uint64_t payloadSize; // Without padding.
+        };
+
+        static_assert(sizeof(FileHeader) == 16 && sizeof(SectionHeader) == 32);
+
+        static constexpr size_t EntryHeaderSize = 16;
+        static constexpr uint32_t EntryKindShift = 24;
+        static constexpr uint32_t MaxEntryKeys = 1u << EntryKindShift;
+
+        // Section located by parse(), payload points into the loaded buffer.
+        struct Section
+        {
+            bool present = false;
+            SectionHeader header{};
+            std::span<const std::byte> payload;
+        };
+
+        struct Entry
+        {
+            uint64_t typeHash;
+            uint32_t index;
+            Kind kind;
+            std::span<const std::byte> value;
+        };
+
+        template <typename Type>
+        concept BlockType = std::is_trivially_copyable_v<Type>;
+
+        template <typename Type>
+        concept StringType = !BlockType<Type> && requires(Type& value, const char* data, size_t size) {
+            { value.data() } -> std::convertible_to<const char*>;
+            { value.size() } -> std::convertible_to<size_t>;
+            value.assign(data, size);
+        };
+
+        template <typename Type>
+        concept Serializable = BlockType<Type> || StringType<Type>;
+
+        // Enums are stored as their underlying type.
+        template <typename Type>
+        constexpr Kind kindOf()
+        {
+            if constexpr (std::is_enum_v<Type>)
+            {
+                return kindOf<std::underlying_type_t<Type>>();
+            }
+            else if constexpr (std::is_same_v<Type, bool>)
+            {
+                return Kind::Bool;
+            }
+            else if constexpr (std::is_integral_v<Type>)
+            {
+                return std::is_signed_v<Type> ? Kind::Signed : Kind::Unsigned;
+            }
+            else if constexpr (std::is_floating_point_v<Type>)
+            {
+                return Kind::Float;
+            }
+            else if constexpr (StringType<Type>)
+            {
+                return Kind::String;
+            }
+            else
+            {
+                return Kind::Raw;
+            }
+        }
+
+        template <typename Type>
+        bool sameKind(Kind kind)
+        {
+            return kind == Kind::Untagged || kind == kindOf<Type>();
+        }
+
+        // -----------------------------------------------------------------
+
+        template <typename T>
+        T byteswap(T value)
+        {
+            auto bytes = std::bit_cast<std::array<std::byte, sizeof(T)>>(value);
+            std::reverse(bytes.begin(), bytes.end());
+            return std::bit_cast<T>(bytes);
+        }
+
+        // Native <-> little-endian for a single value.
+        template <typename T>
+        T littleEndian(T value)
+        {
+            if constexpr (std::endian::native == std::endian::little || sizeof(T) == 1)
+            {
+                return value;
+            }
+            else
+            {
+                static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>,
+                              "Only scalar profile types can be stored on big-endian hosts");
+                return byteswap(value);
+            }
+        }
+
+        template <typename T>
+        void writeValues(Writer& writer, const T* values, size_t count)
+        {
+            if constexpr (std::endian::native == std::endian::little || sizeof(T) == 1)
+            {
+                writer.write(std::as_bytes(std::span{ values, count }));
+            }
+            else
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    auto value = littleEndian(values[i]);
+                    writer.write(std::as_bytes(std::span{ &value, 1 }));
+                }
+            }
+        }
+
+        template <typename T>
+        void readValues(const std::byte* src, T* values, size_t count)
+        {
+            std::memcpy(values, src, count * sizeof(T));
+            if constexpr (std::endian::native != std::endian::little && sizeof(T) != 1)
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    values[i] = littleEndian(values[i]);
+                }
+            }
+        }
+
+        inline void writePadding(Writer& writer, size_t size)
+        {
+            static constexpr std::array<std::byte, Alignment> zeros{};
+            writer.write(std::span{ zeros.data(), (Alignment - size % Alignment) % Alignment });
+        }
+
+        inline void writeFileHeader(Writer& writer, uint32_t sectionsCount)
+        {
+            std::array<uint32_t, 4> fields{ Magic, Version, sectionsCount, 0u };
+            writeValues(writer, fields.data(), fields.size());
+        }
+
+        inline void writeSectionHeader(Writer& writer, const SectionHeader& header)
+        {
+            auto typeHash = header.typeHash;
+            std::array<uint32_t, 4> fields{
+                static_cast<uint32_t>(header.encoding), header.elementSize, header.count, static_cast<uint32_t>(header.kind)
+            };
+            auto payloadSize = header.payloadSize;
+
+            writeValues(writer, &typeHash, 1);
+            writeValues(writer, fields.data(), fields.size());
+            writeValues(writer, &payloadSize, 1);
+        }
+
+        // Values is a profile storage: indexable, contiguous if it has data().
+        template <typename Values>
+        void writeSection(Writer& writer, uint64_t typeHash, const Values& values, size_t count)
+        {
+            using Type = typename Values::value_type;
+            static_assert(Serializable<Type>, "Profile type must be trivially copyable or string-like");
+
+            if constexpr (BlockType<Type>)
+            {
+                auto payloadSize = count * sizeof(Type);
+                writeSectionHeader(writer, { typeHash, Encoding::Block, sizeof(Type), static_cast<uint32_t>(count), kindOf<Type>(), payloadSize });
+                if constexpr (requires { values.data(); })
+                {
+                    writeValues(writer, values.data(), count);
+                }
+                else
+                {
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        writeValues(writer, &values[i], 1);
+                    }
+                }
+                writePadding(writer, payloadSize);
+            }
+            else
+            {
+                using Char = std::remove_cvref_t<decltype(*values[0].data())>;
+                static_assert(sizeof(Char) == 1, "Only narrow strings can be stored");
+
+                std::vector<uint32_t> lengths(count);
+                size_t charsSize = 0;
+                for (size_t i = 0; i < count; i++)
+                {
+                    lengths[i] = static_cast<uint32_t>(values[i].size());
+                    charsSize += lengths[i];
+                }
+
+                auto payloadSize = count * sizeof(uint32_t) + charsSize;
+                writeSectionHeader(writer, { typeHash, Encoding::Strings, 1u, static_cast<uint32_t>(count), kindOf<Type>(), payloadSize });
+                writeValues(writer, lengths.data(), count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    writer.write(std::as_bytes(std::span{ values[i].data(), lengths[i] }));
+                }
+                writePadding(writer, payloadSize);
+            }
+        }
+
+        // False if bytes are not valid object representations of Type: a bool must be
+        // 0 or 1, anything else would be undefined behaviour once copied in.
+        template <typename Type>
+        bool validValues(std::span<const std::byte> bytes)
+        {
+            if constexpr (std::is_same_v<Type, bool>)
+            {
+                return std::all_of(bytes.begin(), bytes.end(), [](std::byte b) {
+                    return b == std::byte{ 0 } || b == std::byte{ 1 };
+                });
+            }
+            else
+            {
+                return true;
+            }
+        }
+
+        // False if the section was written for a different Type or holds invalid values.
+        template <typename Type>
+        bool compatible(const Section& section)
+        {
+            if (!sameKind<Type>(section.header.kind))
+            {
+                return false;
+            }
+
+            if constexpr (BlockType<Type>)
+            {
+                return section.header.encoding == Encoding::Block && section.header.elementSize == sizeof(Type)
+                       && validValues<Type>(section.payload);
+            }
+            else
+            {
+                return section.header.encoding == Encoding::Strings;
+            }
+        }
+
+        // Reads the first count values of a compatible section, in bulk if values is
+        // contiguous, through values.set() otherwise.
+        template <typename Values>
+        void readSection(const Section& section, Values& values, size_t count)
+        {
+            using Type = typename Values::value_type;
+            const auto* src = section.payload.data();
+
+            if constexpr (BlockType<Type> && requires { values.data(); })
+            {
+                readValues(src, values.data(), count);
+            }
+            else if constexpr (BlockType<Type>)
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    Type value;
+                    readValues(src + i * sizeof(Type), &value, 1);
+                    values.set(i, value);
+                }
+            }
+            else
+            {
+                const auto* chars = src + section.header.count * sizeof(uint32_t);
+                for (size_t i = 0; i < count; i++)
+                {
+                    uint32_t length;
+                    readValues(src + i * sizeof(uint32_t), &length, 1);
+                    if constexpr (requires { values.data(); })
+                    {
+                        values.data()[i].assign(reinterpret_cast<const char*>(chars), length);
+                    }
+                    else
+                    {
+                        Type value;
+                        value.assign(reinterpret_cast<const char*>(chars), length);
+                        values.set(i, std::move(value));
+                    }
+                    chars += length;
+                }
+            }
+        }
+
+        template <typename Type>
+        bool compatible(const Entry& entry)
+        {
+            if (!sameKind<Type>(entry.kind))
+            {
+                return false;
+            }
+
+            if constexpr (BlockType<Type>)
+            {
+                return entry.value.size() == sizeof(Type) && validValues<Type>(entry.value);
+            }
+            else
+            {
+                return true;
+            }
+        }
+
+        // Value is Type, or a view of it for strings. Index must be below MaxEntryKeys.
+        template <typename Type, typename Value = Type>
+        void writeEntry(Writer& writer, uint64_t typeHash, uint32_t index, const Value& value)
+        {
+            static_assert(Serializable<Type>, "Profile type must be trivially copyable or string-like");
+            static_assert(StringType<Type> || std::is_same_v<Type, Value>);
+
+            index |= static_cast<uint32_t>(kindOf<Type>()) << EntryKindShift;
+            if constexpr (BlockType<Type>)
+            {
+                std::array<uint32_t, 2> fields{ index, static_cast<uint32_t>(sizeof(Type)) };
+                writeValues(writer, &typeHash, 1);
+                writeValues(writer, fields.data(), fields.size());
+                writeValues(writer, &value, 1);
+            }
+            else
+            {
+                std::array<uint32_t, 2> fields{ index, static_cast<uint32_t>(value.size()) };
+                writeValues(writer, &typeHash, 1);
+                writeValues(writer, fields.data(), fields.size());
+                writer.write(std::as_bytes(std::span{ value.data(), value.size() }));
+            }
+        }
+
+        // Reads the value of a compatible entry.
+        template <typename Type>
+        void readEntry(const Entry& entry, Type& value)
+        {
+            if constexpr (BlockType<Type>)
+            {
+                readValues(entry.value.data(), &value, 1);
+            }
+            else
+            {
+                value.assign(reinterpret_cast<const char*>(entry.value.data()), entry.value.size());
+            }
+        }
+
+        // Calls func(const Entry&) for every entry until it returns false.
+        // Returns false if func did or the entries are truncated.
+        template <typename Func>
+        bool parseEntries(std::span<const std::byte> bytes, Func&& func)
+        {
+            size_t offset = 0;
+            while (offset != bytes.size())
+            {
+                if (bytes.size() - offset < EntryHeaderSize)
+                {
+                    return false;
+                }
+
+                Entry entry;
+                std::array<uint32_t, 2> fields;
+                readValues(bytes.data() + offset, &entry.typeHash, 1);
+                readValues(bytes.data() + offset + 8, fields.data(), fields.size());
+                offset += EntryHeaderSize;
+
+                if (fields[1] > bytes.size() - offset)
+                {
+                    return false;
+                }
+                entry.index = fields[0] & (MaxEntryKeys - 1);
+                entry.kind = static_cast<Kind>(fields[0] >> EntryKindShift);
+                entry.value = bytes.subspan(offset, fields[1]);
+                offset += fields[1];
+
+                if (!func(entry))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // FNV-1a, 32 bit, guards journal records against torn writes.
+        inline uint32_t checksum(std::span<const std::byte> bytes)
+        {
+            uint32_t h = 2166136261u;
+            for (auto b : bytes)
+            {
+                h ^= static_cast<uint32_t>(b);
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+        // Validates a snapshot and locates its sections; unknown sections are skipped.
+        // Returns false if the buffer is truncated, corrupt or of a newer version.
+        template <size_t N, typename IndexOf>
+        bool parse(std::span<const std::byte> bytes, std::array<Section, N>& sections, IndexOf&& indexOf)
+        {
+            if (bytes.size() < sizeof(FileHeader))
+            {
+                return false;
+            }
+
+            std::array<uint32_t, 4> fields;
+            readValues(bytes.data(), fields.data(), fields.size());
+            if (fields[0] != Magic || fields[1] == 0u || fields[1] > Version)
+            {
+                return false;
+            }
+
+            size_t offset = sizeof(FileHeader);
+            for (uint32_t s = 0; s < fields[2]; s++)
+            {
+                if (bytes.size() - offset < sizeof(SectionHeader))
+                {
+                    return false;
+                }
+
+                SectionHeader header;
+                const auto* src = bytes.data() + offset;
+                std::array<uint32_t, 4> sectionFields;
+                readValues(src, &header.typeHash, 1);
+                readValues(src + 8, sectionFields.data(), sectionFields.size());
+                readValues(src + 24, &header.payloadSize, 1);
+                header.encoding = static_cast<Encoding>(sectionFields[0]);
+                header.elementSize = sectionFields[1];
+                header.count = sectionFields[2];
+                header.kind = static_cast<Kind>(sectionFields[3]);
+                offset += sizeof(SectionHeader);
+
+                if (header.payloadSize > bytes.size() - offset)
+                {
+                    return false;
+                }
+                auto payload = bytes.subspan(offset, static_cast<size_t>(header.payloadSize));
+
+                // Sizes inside the payload must add up before anything is applied.
+                if (header.encoding == Encoding::Block)
+                {
+                    if (uint64_t{ header.count } * header.elementSize != header.payloadSize)
+                    {
+                        return false;
+                    }
+                }
+                else if (header.encoding == Encoding::Strings)
+                {
+                    uint64_t size = uint64_t{ header.count } * sizeof(uint32_t);
+                    if (size > payload.size())
+                    {
+                        return false;
+                    }
+                    for (uint32_t i = 0; i < header.count; i++)
+                    {
+                        uint32_t length;
+                        readValues(payload.data() + i * sizeof(uint32_t), &length, 1);
+                        size += length;
+                    }
+                    if (size != header.payloadSize)
+                    {
+                        return false;
+                    }
+                }
+
+                auto idx = indexOf(header.typeHash);
+                if (idx < N)
+                {
+                    sections[idx] = { true, header, payload };
+                }
+
+                auto padded = offset + static_cast<size_t>(header.payloadSize);
+                padded += (Alignment - padded % Alignment) % Alignment;
+                offset = padded < bytes.size() ? padded : bytes.size();
+            }
+            return true;
+        }
+
+    } // namespace snapshot
+
+} // namespace easyprofile
@@ -0,0 +1,89 @@
+/**********************************************\
+*
+*  Easy Profile library
+*  by Andrey A. Ugolnik
+*  https://github.com/reybits
+*
+\**********************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace easyprofile
+{
+    // Operation counts of a key, collected with EASY_PROFILE_STATS defined.
+    // sets counts every set(), modify() and key written by setRange(); changes only those that
+    // stored a different value. notifies counts deliveries to listeners, one per listener.
+    struct alignas(32) KeyStats
+    {
+        uint64_t gets = 0;
+        uint64_t sets = 0;
+        uint64_t changes = 0;
+        uint64_t notifies = 0;
+
+        // set() calls that left the value as it was.
+        uint64_t wastedSets() const
+        {
+            return sets - changes;
+        }
+
+        KeyStats& operator+=(const KeyStats& other)
+        {
+            gets += other.gets;
+            sets += other.sets;
+            changes += other.changes;
+            notifies += other.notifies;
+            return *this;
+        }
+    };
+
+    namespace detail
+    {
+        // Side table of KeyStats of all keys of a profile, allocated on first use so profiles
+        // that are never touched don't pay for it. The counters of a key share a cache line.
+        template <size_t Size>
+        class KeyCounters
+        {
+        public:
+            KeyStats& operator[](size_t idx)
+            {
+                if (!m_keys)
+                {
+                    m_keys = std::make_unique<KeyStats[]>(Size);
+                }
+                return m_keys[idx];
+            }
+
+            // Calls func(idx, stats) for every key of [first, last) with a non-zero counter.
+            template <typename Func>
+            void forEach(size_t first, size_t last, Func&& func) const
+            {
+                if (!m_keys)
+                {
+                    return;
+                }
+                for (auto i = first; i < last; i++)
+                {
+                    const auto& stats = m_keys[i];
+                    if ((stats.gets | stats.sets | stats.notifies) != 0)
+                    {
+                        func(i, stats);
+                    }
+                }
+            }
+
+            void clear()
+            {
+                m_keys.reset();
+            }
+
+        private:
+            std::unique_ptr<KeyStats[]> m_keys;
+        };
+
+    } // namespace detail
+
+} // namespace easyprofile
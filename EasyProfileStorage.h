@@ -0,0 +1,732 @@
+/**********************************************\
+*
+*  Easy Profile library
+*  by Andrey A. Ugolnik
+*  https://github.com/reybits
+*
+\**********************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifndef ASSERT
+#    ifndef NDEBUG
+#        include <cassert>
+#        define ASSERT(x) assert(x)
+#    else
+#        define ASSERT(x)
+#    endif
+#endif
+
+namespace easyprofile
+{
+    namespace detail
+    {
+        // Applies func to value, returns true if the value changed.
+        template <typename Type, typename Func>
+        bool modify(Type& value, Func&& func)
+        {
+            if constexpr (std::is_same_v<std::invoke_result_t<Func, Type&>, bool>)
+            {
+                return func(value);
+            }
+            else
+            {
+                const Type old = value;
+                func(value);
+                return value != old;
+            }
+        }
+
+        // True if value is not its default. Trivially copyable values with the same bytes
+        // are equal, so a NaN restored from its default is not reported as changed.
+        template <typename Type>
+        bool differs(const Type& value, const Type& defaultValue)
+        {
+            if constexpr (std::is_trivially_copyable_v<Type>)
+            {
+                if (std::memcmp(&value, &defaultValue, sizeof(Type)) == 0)
+                {
+                    return false;
+                }
+            }
+            return value != defaultValue;
+        }
+
+        // Same for a stored value read as a view, e.g. a string arena value.
+        template <typename Value, typename Type>
+            requires(!std::is_same_v<Value, Type>)
+        bool differs(const Value& value, const Type& other)
+        {
+            return value != other;
+        }
+
+        // Defaults of a storage constructed without any, every value value-initialized.
+        template <typename Type, size_t Size>
+        inline const std::array<Type, Size> EmptyDefaults{};
+
+        // Defaults array passed to a profile, which keeps it by reference for reset(). Binds
+        // to a named array only, a temporary would dangle and does not compile.
+        template <typename Type, size_t Size>
+        class DefaultsRef final
+        {
+        public:
+            constexpr DefaultsRef(const std::array<Type, Size>& values)
+                : m_values(values)
+            {
+            }
+
+            DefaultsRef(const std::array<Type, Size>&&) = delete;
+
+            constexpr const std::array<Type, Size>& values() const
+            {
+                return m_values;
+            }
+
+        private:
+            const std::array<Type, Size>& m_values;
+        };
+
+        // Values of a PROFILE_TYPE, every key stored in place.
+        // Reads go through m_view, which points either to the own copy or, after share() or
+        // default construction, to the defaults until the first write copies them. Until then m_values is never
+        // touched, for trivially copyable types it isn't even initialized.
+        template <typename Type, size_t Size>
+        class DenseStorage
+        {
+        public:
+            using value_type = Type;
+            using const_reference = const Type&;
+
+            DenseStorage() = default;
+
+            explicit DenseStorage(const std::array<Type, Size>& defaults)
+                : m_defaults(&defaults)
+                , m_values(defaults)
+            {
+                m_view = m_values.data();
+            }
+
+            static constexpr size_t ChunkSize = 64;
+
+            // Copies the defaults, they are kept for reset and must outlive the storage.
+            void init(const std::array<Type, Size>& defaults)
+            {
+                m_defaults = &defaults;
+                m_values = defaults;
+                m_view = m_values.data();
+            }
+
+            // References the defaults until the first write.
+            void share(const std::array<Type, Size>& defaults)
+            {
+                m_defaults = &defaults;
+                m_view = defaults.data();
+            }
+
+            const std::array<Type, Size>& defaults() const
+            {
+                return *m_defaults;
+            }
+
+            // Every key reads its default again. The own copy stays allocated, so references
+            // returned before remain valid.
+            void resetAll()
+            {
+                m_view = m_defaults->data();
+            }
+
+            // Calls func(index, value) for every key that differs from its default.
+            // Trivially copyable values are compared with one memcmp per chunk of keys first,
+            // which skips unchanged chunks at memory bandwidth.
+            template <typename Func>
+            void forEachNonDefault(Func&& func) const
+            {
+                if (isShared())
+                {
+                    return;
+                }
+
+                const auto* defaults = m_defaults->data();
+                for (size_t base = 0; base < Size; base += ChunkSize)
+                {
+                    auto end = std::min(base + ChunkSize, Size);
+                    if constexpr (std::is_trivially_copyable_v<Type>)
+                    {
+                        if (std::memcmp(m_view + base, defaults + base, (end - base) * sizeof(Type)) == 0)
+                        {
+                            continue;
+                        }
+                    }
+
+                    for (auto i = base; i < end; i++)
+                    {
+                        if (differs(m_view[i], defaults[i]))
+                        {
+                            func(i, m_view[i]);
+                        }
+                    }
+                }
+            }
+
+            bool isShared() const
+            {
+                return m_view != m_values.data();
+            }
+
+            static constexpr size_t size()
+            {
+                return Size;
+            }
+
+            const Type& operator[](size_t idx) const
+            {
+                return m_view[idx];
+            }
+
+            Type* data()
+            {
+                return values().data();
+            }
+
+            const Type* data() const
+            {
+                return m_view;
+            }
+
+            // Valid until the next write.
+            std::span<const Type, Size> span() const
+            {
+                return std::span<const Type, Size>(m_view, Size);
+            }
+
+            // Returns true if the value changed.
+            template <typename Value>
+            bool set(size_t idx, Value&& value)
+            {
+                if (m_view[idx] != value)
+                {
+                    values()[idx] = std::forward<Value>(value);
+                    return true;
+                }
+                return false;
+            }
+
+            template <typename Func>
+            bool modify(size_t idx, Func&& func)
+            {
+                return detail::modify(values()[idx], std::forward<Func>(func));
+            }
+
+            // Assigns values to the keys starting at first, calls changed(index) for each key
+            // that differed. Trivially copyable chunks equal to the current values are skipped
+            // after one memcmp.
+            template <typename Func>
+            void setRange(size_t first, std::span<const Type> values, Func&& changed)
+            {
+                for (size_t base = 0; base < values.size(); base += ChunkSize)
+                {
+                    auto end = std::min(base + ChunkSize, values.size());
+                    if constexpr (std::is_trivially_copyable_v<Type>)
+                    {
+                        if (std::memcmp(m_view + first + base, values.data() + base, (end - base) * sizeof(Type)) == 0)
+                        {
+                            continue;
+                        }
+                    }
+
+                    for (auto i = base; i < end; i++)
+                    {
+                        if (set(first + i, values[i]))
+                        {
+                            changed(first + i);
+                        }
+                    }
+                }
+            }
+
+        private:
+            DenseStorage(const DenseStorage&) = delete;
+            DenseStorage& operator=(const DenseStorage&) = delete;
+
+            std::array<Type, Size>& values()
+            {
+                if (isShared())
+                {
+                    std::copy_n(m_view, Size, m_values.data());
+                    m_view = m_values.data();
+                }
+                return m_values;
+            }
+
+        private:
+            const std::array<Type, Size>* m_defaults = &EmptyDefaults<Type, Size>;
+            const Type* m_view = EmptyDefaults<Type, Size>.data();
+            std::array<Type, Size> m_values;
+        };
+
+        // Values of a PROFILE_TYPE on top of defaults shared by many profiles, only keys that
+        // differ from their default are stored. Overrides are found through a bitmap and the
+        // number of overrides before each 64 key word, so get() costs a popcount.
+        // Values live in a deque, references returned by get() survive other overrides.
+        template <typename Type, size_t Size>
+        class OverlayStorage
+        {
+        public:
+            using value_type = Type;
+            using const_reference = const Type&;
+
+            static constexpr size_t WordBits = 64;
+            static constexpr size_t WordsCount = (Size + WordBits - 1) / WordBits;
+
+            OverlayStorage() = default;
+
+            // Defaults are referenced, not copied, and must outlive the profile.
+            explicit OverlayStorage(const std::array<Type, Size>& defaults)
+                : m_defaults(&defaults)
+            {
+            }
+
+            void init(const std::array<Type, Size>& defaults)
+            {
+                m_defaults = &defaults;
+                m_overrides.reset();
+            }
+
+            void share(const std::array<Type, Size>& defaults)
+            {
+                init(defaults);
+            }
+
+            const std::array<Type, Size>& defaults() const
+            {
+                return *m_defaults;
+            }
+
+            // Drops every override. Their values stay allocated for reuse, so references
+            // returned before remain valid.
+            void resetAll()
+            {
+                if (m_overrides != nullptr)
+                {
+                    auto& o = *m_overrides;
+                    o.freeSlots.insert(o.freeSlots.end(), o.slots.begin(), o.slots.end());
+                    o.slots.clear();
+                    o.words.fill(0u);
+                    o.ranks.fill(0u);
+                }
+            }
+
+            // Calls func(index, value) for every override, func may reset the key.
+            template <typename Func>
+            void forEachNonDefault(Func&& func) const
+            {
+                if (m_overrides == nullptr)
+                {
+                    return;
+                }
+
+                for (size_t w = 0; w < WordsCount; w++)
+                {
+                    auto word = m_overrides->words[w];
+                    while (word != 0u)
+                    {
+                        auto idx = w * WordBits + static_cast<size_t>(std::countr_zero(word));
+                        func(idx, (*this)[idx]);
+                        word &= word - 1u;
+                    }
+                }
+            }
+
+            static constexpr size_t size()
+            {
+                return Size;
+            }
+
+            const Type& operator[](size_t idx) const
+            {
+                if (m_overrides != nullptr)
+                {
+                    auto word = m_overrides->words[idx / WordBits];
+                    auto bit = uint64_t{ 1u } << (idx % WordBits);
+                    if ((word & bit) != 0u)
+                    {
+                        return m_overrides->values[m_overrides->slots[rank(word, bit, idx)]];
+                    }
+                }
+                return (*m_defaults)[idx];
+            }
+
+            template <typename Value>
+            bool set(size_t idx, Value&& value)
+            {
+                if (!((*this)[idx] != value))
+                {
+                    return false;
+                }
+
+                if (differs(value, (*m_defaults)[idx]))
+                {
+                    materialize(idx) = std::forward<Value>(value);
+                }
+                else
+                {
+                    erase(idx);
+                }
+                return true;
+            }
+
+            template <typename Func>
+            bool modify(size_t idx, Func&& func)
+            {
+                auto& v = materialize(idx);
+                auto changed = detail::modify(v, std::forward<Func>(func));
+                if (!differs(v, (*m_defaults)[idx]))
+                {
+                    erase(idx);
+                }
+                return changed;
+            }
+
+            template <typename Func>
+            void setRange(size_t first, std::span<const Type> values, Func&& changed)
+            {
+                for (size_t i = 0; i < values.size(); i++)
+                {
+                    if (set(first + i, values[i]))
+                    {
+                        changed(first + i);
+                    }
+                }
+            }
+
+            size_t overridesCount() const
+            {
+                return m_overrides != nullptr ? m_overrides->slots.size() : 0;
+            }
+
+        private:
+            struct Overrides
+            {
+                std::array<uint64_t, WordsCount> words{};
+                std::array<uint32_t, WordsCount> ranks{};
+                std::vector<uint32_t> slots; // Value slot of every override, in key order.
+                std::vector<uint32_t> freeSlots;
+                std::deque<Type> values;
+            };
+
+            size_t rank(uint64_t word, uint64_t bit, size_t idx) const
+            {
+                return m_overrides->ranks[idx / WordBits] + static_cast<size_t>(std::popcount(word & (bit - 1u)));
+            }
+
+            Type& materialize(size_t idx)
+            {
+                if (m_overrides == nullptr)
+                {
+                    m_overrides = std::make_unique<Overrides>();
+                }
+
+                auto& o = *m_overrides;
+                auto w = idx / WordBits;
+                auto bit = uint64_t{ 1u } << (idx % WordBits);
+                auto pos = rank(o.words[w], bit, idx);
+                if ((o.words[w] & bit) != 0u)
+                {
+                    return o.values[o.slots[pos]];
+                }
+
+                uint32_t slot;
+                if (!o.freeSlots.empty())
+                {
+                    slot = o.freeSlots.back();
+                    o.freeSlots.pop_back();
+                    o.values[slot] = (*m_defaults)[idx];
+                }
+                else
+                {
+                    slot = static_cast<uint32_t>(o.values.size());
+                    o.values.push_back((*m_defaults)[idx]);
+                }
+
+                o.slots.insert(o.slots.begin() + static_cast<std::ptrdiff_t>(pos), slot);
+                o.words[w] |= bit;
+                for (auto i = w + 1; i < WordsCount; i++)
+                {
+                    o.ranks[i]++;
+                }
+                return o.values[slot];
+            }
+
+            void erase(size_t idx)
+            {
+                if (m_overrides == nullptr)
+                {
+                    return;
+                }
+
+                auto& o = *m_overrides;
+                auto w = idx / WordBits;
+                auto bit = uint64_t{ 1u } << (idx % WordBits);
+                if ((o.words[w] & bit) == 0u)
+                {
+                    return;
+                }
+
+                auto pos = rank(o.words[w], bit, idx);
+                o.freeSlots.push_back(o.slots[pos]);
+                o.slots.erase(o.slots.begin() + static_cast<std::ptrdiff_t>(pos));
+                o.words[w] &= ~bit;
+                for (auto i = w + 1; i < WordsCount; i++)
+                {
+                    o.ranks[i]--;
+                }
+            }
+
+        private:
+            const std::array<Type, Size>* m_defaults = &EmptyDefaults<Type, Size>;
+            std::unique_ptr<Overrides> m_overrides;
+        };
+
+        // Strings of a PROFILE_TYPE packed into one buffer. A key is an offset and length
+        // into it, or reads its shared default. Values are string views, valid until the next
+        // change of a key of the same type. set() overwrites a value in place when the new one
+        // fits its slot, otherwise appends it. Once more than half of the buffer is garbage it
+        // is compacted, in key order.
+        template <typename Type, size_t Size>
+        class StringArenaStorage
+        {
+        public:
+            using value_type = Type;
+            using const_reference = std::basic_string_view<typename Type::value_type>;
+
+            static constexpr size_t MinCompactSize = 1024;
+
+            StringArenaStorage() = default;
+
+            // Defaults are referenced, not copied, and must outlive the profile.
+            explicit StringArenaStorage(const std::array<Type, Size>& defaults)
+                : m_defaults(&defaults)
+            {
+            }
+
+            void init(const std::array<Type, Size>& defaults)
+            {
+                m_defaults = &defaults;
+                resetAll();
+            }
+
+            void share(const std::array<Type, Size>& defaults)
+            {
+                init(defaults);
+            }
+
+            const std::array<Type, Size>& defaults() const
+            {
+                return *m_defaults;
+            }
+
+            static constexpr size_t size()
+            {
+                return Size;
+            }
+
+            const_reference operator[](size_t idx) const
+            {
+                const auto& slot = m_slots[idx];
+                if (slot.offset == DefaultOffset)
+                {
+                    return const_reference((*m_defaults)[idx]);
+                }
+                return const_reference(m_buffer.data() + slot.offset, slot.length);
+            }
+
+            template <typename Value>
+            bool set(size_t idx, const Value& value)
+            {
+                const_reference view(value);
+                if ((*this)[idx] == view)
+                {
+                    return false;
+                }
+
+                auto& slot = m_slots[idx];
+                if (const_reference((*m_defaults)[idx]) == view)
+                {
+                    release(slot);
+                }
+                else if (slot.offset != DefaultOffset && view.size() <= slot.capacity)
+                {
+                    std::char_traits<typename Type::value_type>::move(m_buffer.data() + slot.offset, view.data(), view.size());
+                    slot.length = static_cast<uint32_t>(view.size());
+                }
+                else
+                {
+                    append(slot, view);
+                }
+                return true;
+            }
+
+            template <typename Func>
+            bool modify(size_t idx, Func&& func)
+            {
+                Type value((*this)[idx]);
+                return detail::modify(value, std::forward<Func>(func)) && set(idx, value);
+            }
+
+            template <typename Func>
+            void setRange(size_t first, std::span<const Type> values, Func&& changed)
+            {
+                for (size_t i = 0; i < values.size(); i++)
+                {
+                    if (set(first + i, values[i]))
+                    {
+                        changed(first + i);
+                    }
+                }
+            }
+
+            void resetAll()
+            {
+                m_slots.fill(Slot{});
+                m_buffer.clear();
+                m_garbage = 0;
+            }
+
+            template <typename Func>
+            void forEachNonDefault(Func&& func) const
+            {
+                for (size_t idx = 0; idx < Size; idx++)
+                {
+                    if (m_slots[idx].offset != DefaultOffset)
+                    {
+                        func(idx, (*this)[idx]);
+                    }
+                }
+            }
+
+            size_t arenaSize() const
+            {
+                return m_buffer.size();
+            }
+
+            size_t garbageSize() const
+            {
+                return m_garbage;
+            }
+
+        private:
+            StringArenaStorage(const StringArenaStorage&) = delete;
+            StringArenaStorage& operator=(const StringArenaStorage&) = delete;
+
+            static constexpr uint32_t DefaultOffset = UINT32_MAX;
+
+            struct Slot
+            {
+                uint32_t offset = DefaultOffset;
+                uint32_t length = 0;
+                uint32_t capacity = 0;
+            };
+
+            void release(Slot& slot)
+            {
+                if (slot.offset != DefaultOffset)
+                {
+                    m_garbage += slot.capacity;
+                    slot = Slot{};
+                }
+            }
+
+            void append(Slot& slot, const_reference view)
+            {
+                // The value may be a view of this buffer, which is about to grow.
+                std::less<const typename Type::value_type*> less;
+                if (!less(view.data(), m_buffer.data()) && less(view.data(), m_buffer.data() + m_buffer.size()))
+                {
+                    Type copy(view);
+                    append(slot, const_reference(copy));
+                    return;
+                }
+
+                ASSERT(m_buffer.size() + view.size() < DefaultOffset);
+                release(slot);
+                slot.offset = static_cast<uint32_t>(m_buffer.size());
+                slot.length = static_cast<uint32_t>(view.size());
+                slot.capacity = slot.length;
+                m_buffer.insert(m_buffer.end(), view.begin(), view.end());
+
+                if (m_garbage >= MinCompactSize && m_garbage * 2 >= m_buffer.size())
+                {
+                    compact();
+                }
+            }
+
+            void compact()
+            {
+                std::vector<typename Type::value_type> buffer;
+                buffer.reserve(m_buffer.size() - m_garbage);
+                for (auto& slot : m_slots)
+                {
+                    if (slot.offset != DefaultOffset)
+                    {
+                        auto offset = static_cast<uint32_t>(buffer.size());
+                        buffer.insert(buffer.end(), m_buffer.begin() + slot.offset, m_buffer.begin() + slot.offset + slot.length);
+                        slot.offset = offset;
+                        slot.capacity = slot.length;
+                    }
+                }
+                m_buffer.swap(buffer);
+                m_garbage = 0;
+            }
+
+        private:
+            const std::array<Type, Size>* m_defaults = &EmptyDefaults<Type, Size>;
+            std::array<Slot, Size> m_slots;
+            std::vector<typename Type::value_type> m_buffer;
+            size_t m_garbage = 0;
+        };
+
+        template <typename Type>
+        inline constexpr bool IsStdString = false;
+
+        template <typename Char, typename Traits, typename Alloc>
+        inline constexpr bool IsStdString<std::basic_string<Char, Traits, Alloc>> = true;
+
+#if defined(EASY_PROFILE_OVERLAY)
+        template <typename Type, size_t Size>
+        using ValueStorage = OverlayStorage<Type, Size>;
+#else
+        template <typename Type, size_t Size>
+        using ValueStorage = DenseStorage<Type, Size>;
+#endif
+
+#if defined(EASY_PROFILE_STRING_ARENA)
+        template <typename Type, size_t Size>
+        using Storage = std::conditional_t<IsStdString<Type>, StringArenaStorage<Type, Size>, ValueStorage<Type, Size>>;
+#else
+        template <typename Type, size_t Size>
+        using Storage = ValueStorage<Type, Size>;
+#endif
+
+        // What get() returns: const Type&, or a string view with EASY_PROFILE_STRING_ARENA.
+        template <typename Type, size_t Size>
+        using ValueRef = typename Storage<Type, Size>::const_reference;
+
+    } // namespace detail
+
+} // namespace easyprofile
@@ -0,0 +1,294 @@
+/**********************************************\
+*
+*  Easy Profile library
+*  by Andrey A. Ugolnik
+*  https://github.com/reybits
+*
+\**********************************************/
+
+#pragma once
+
+#include "EasyProfileSnapshot.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#if defined(EASY_PROFILE_TRACE_TSC) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#    include <immintrin.h>
+#    define EASY_PROFILE_TRACE_TICKS_TSC
+#endif
+
+namespace easyprofile
+{
+    // One listener call, recorded by a Tracer attached with Profile::setTracer().
+    struct TraceSample
+    {
+        const char* listener; // Listener::getName(), must outlive the tracer.
+        const char* type;     // PROFILE_TYPE name, nullptr for onProfileBatch().
+        uint32_t key;         // Key index, or the number of keys of onProfileBatch().
+        uint32_t thread;      // Small id of the notifying thread, 1 for the first one.
+        uint64_t start;       // Nanoseconds since the tracer was created.
+        uint64_t duration;    // Nanoseconds.
+    };
+
+    namespace detail
+    {
+        inline uint64_t traceNow()
+        {
+            auto now = std::chrono::steady_clock::now().time_since_epoch();
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+        }
+
+        // Timestamps of listener calls: the TSC with EASY_PROFILE_TRACE_TSC on x86, converted
+        // by the Tracer, otherwise steady_clock nanoseconds.
+        inline uint64_t traceTicks()
+        {
+#if defined(EASY_PROFILE_TRACE_TICKS_TSC)
+            return __rdtsc();
+#else
+            return traceNow();
+#endif
+        }
+
+        inline uint32_t traceThread()
+        {
+            static std::atomic<uint32_t> next{ 1u };
+            thread_local uint32_t id = next.fetch_add(1u, std::memory_order_relaxed);
+            return id;
+        }
+
+    } // namespace detail
+
+    // Lock-free ring of the latest TraceSamples, with an optional callback for listener calls
+    // over a time budget. Any thread may record and read. A slot is claimed with a CAS on its
+    // sequence, so a record() that finds its slot still being written by a thread that lapped
+    // the ring, or already holds a newer sample, is dropped rather than mixed. Readers skip
+    // slots written while they copy them.
+    class Tracer final
+    {
+    public:
+        using SlowListener = std::function<void(const TraceSample& sample)>;
+
+        // capacity is rounded up to a power of two.
+        explicit Tracer(size_t capacity = 4096)
+            : m_mask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1)
+            , m_slots(std::make_unique<Slot[]>(m_mask + 1))
+            , m_originNs(detail::traceNow())
+            , m_originTicks(detail::traceTicks())
+        {
+        }
+
+        // Called on the notifying thread after a listener call took longer than budget.
+        // Not synchronized with record(), set it before attaching the tracer. With the TSC
+        // the tick rate is measured here, which waits until 1 ms after construction.
+        void setSlowListener(std::chrono::nanoseconds budget, SlowListener callback)
+        {
+#if defined(EASY_PROFILE_TRACE_TICKS_TSC)
+            while (detail::traceNow() - m_originNs < 1000000u)
+            {
+            }
+#endif
+            m_nsPerTick = nsPerTick();
+            m_budget = static_cast<uint64_t>(static_cast<double>(budget.count()) / m_nsPerTick);
+            m_slowListener = std::move(callback);
+        }
+
+        // start and duration in detail::traceTicks() units.
+        void record(const char* listener, const char* type, uint32_t key, uint64_t start, uint64_t duration)
+        {
+            TraceSample sample{ listener, type, key, detail::traceThread(), start, duration };
+
+            auto pos = m_head.fetch_add(1u, std::memory_order_relaxed);
+            auto& slot = m_slots[pos & m_mask];
+            auto seq = slot.seq.load(std::memory_order_relaxed);
+            bool claimed = (seq & 1u) == 0u && seq <= pos * 2
+                           && slot.seq.compare_exchange_strong(seq, pos * 2 + 1, std::memory_order_relaxed);
+            if (!claimed)
+            {
+                m_dropped.fetch_add(1u, std::memory_order_relaxed);
+            }
+            else
+            {
+                auto words = toWords(sample);
+                for (size_t w = 0; w < WordsCount; w++)
+                {
+                    slot.words[w].store(words[w], std::memory_order_release);
+                }
+                slot.seq.store(pos * 2 + 2, std::memory_order_release);
+            }
+
+            if (m_slowListener && duration > m_budget)
+            {
+                m_slowListener(toNanoseconds(sample, m_nsPerTick));
+            }
+        }
+
+        // Samples still in the ring, oldest first.
+        std::vector<TraceSample> samples() const
+        {
+            auto head = m_head.load(std::memory_order_acquire);
+            auto first = std::max(m_cleared.load(std::memory_order_relaxed), head > m_mask ? head - m_mask - 1 : 0);
+
+            auto scale = nsPerTick();
+            std::vector<TraceSample> result;
+            result.reserve(head - first);
+            for (auto pos = first; pos < head; pos++)
+            {
+                const auto& slot = m_slots[pos & m_mask];
+                if (slot.seq.load(std::memory_order_acquire) != pos * 2 + 2)
+                {
+                    continue;
+                }
+
+                std::array<uint64_t, WordsCount> words;
+                for (size_t w = 0; w < WordsCount; w++)
+                {
+                    words[w] = slot.words[w].load(std::memory_order_acquire);
+                }
+                if (slot.seq.load(std::memory_order_relaxed) == pos * 2 + 2)
+                {
+                    result.push_back(toNanoseconds(fromWords(words), scale));
+                }
+            }
+            return result;
+        }
+
+        // Samples lost because their slot was busy.
+        uint64_t dropped() const
+        {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+        // Forgets the samples recorded so far.
+        void clear()
+        {
+            m_cleared.store(m_head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+
+        // Chrome trace event JSON (chrome://tracing, Perfetto): one complete event per sample,
+        // named after the listener.
+        void writeChromeTrace(Writer& writer) const
+        {
+            std::string json = "{\"traceEvents\":[";
+            char buffer[160];
+            bool first = true;
+            for (const auto& sample : samples())
+            {
+                json += first ? "\n" : ",\n";
+                first = false;
+
+                json += "{\"name\":\"";
+                appendEscaped(json, sample.listener);
+                json += "\",\"cat\":\"";
+                appendEscaped(json, sample.type != nullptr ? sample.type : "batch");
+
+                std::snprintf(buffer, sizeof(buffer),
+                              "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"%s\":%" PRIu32 "}}",
+                              static_cast<double>(sample.start) / 1000.0, static_cast<double>(sample.duration) / 1000.0, sample.thread,
+                              sample.type != nullptr ? "key" : "keys", sample.key);
+                json += buffer;
+            }
+            json += "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+            writer.write(std::as_bytes(std::span{ json }));
+        }
+
+    private:
+        static constexpr size_t WordsCount = sizeof(TraceSample) / sizeof(uint64_t);
+
+        static_assert(sizeof(TraceSample) % sizeof(uint64_t) == 0);
+
+        // Nanoseconds per tick, measured against steady_clock since construction.
+        double nsPerTick() const
+        {
+#if defined(EASY_PROFILE_TRACE_TICKS_TSC)
+            auto ticks = detail::traceTicks() - m_originTicks;
+            auto ns = detail::traceNow() - m_originNs;
+            return ticks != 0 && ns != 0 ? static_cast<double>(ns) / static_cast<double>(ticks) : 1.0;
+#else
+            return 1.0;
+#endif
+        }
+
+        TraceSample toNanoseconds(TraceSample sample, double scale) const
+        {
+            auto start = sample.start - std::min(sample.start, m_originTicks);
+            sample.start = static_cast<uint64_t>(static_cast<double>(start) * scale);
+            sample.duration = static_cast<uint64_t>(static_cast<double>(sample.duration) * scale);
+            return sample;
+        }
+
+        static std::array<uint64_t, WordsCount> toWords(const TraceSample& sample)
+        {
+            std::array<uint64_t, WordsCount> words;
+            std::memcpy(words.data(), &sample, sizeof(TraceSample));
+            return words;
+        }
+
+        static TraceSample fromWords(const std::array<uint64_t, WordsCount>& words)
+        {
+            TraceSample sample;
+            std::memcpy(&sample, words.data(), sizeof(TraceSample));
+            return sample;
+        }
+
+        static void appendEscaped(std::string& json, const char* text)
+        {
+            for (; text != nullptr && *text != '\0'; text++)
+            {
+                auto c = static_cast<unsigned char>(*text);
+                if (c == '"' || c == '\\')
+                {
+                    json += '\\';
+                    json += static_cast<char>(c);
+                }
+                else if (c < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    json += escaped;
+                }
+                else
+                {
+                    json += static_cast<char>(c);
+                }
+            }
+        }
+
+    private:
+        Tracer(const Tracer&) = delete;
+        Tracer& operator=(const Tracer&) = delete;
+
+        struct Slot
+        {
+            std::atomic<uint64_t> seq{ 0u };
+            std::array<std::atomic<uint64_t>, WordsCount> words{};
+        };
+
+        const uint64_t m_mask;
+        std::unique_ptr<Slot[]> m_slots;
+        const uint64_t m_originNs;
+        const uint64_t m_originTicks;
+        std::atomic<uint64_t> m_head{ 0u };
+        std::atomic<uint64_t> m_cleared{ 0u };
+        std::atomic<uint64_t> m_dropped{ 0u };
+
+        double m_nsPerTick = 1.0;
+        uint64_t m_budget = 0;
+        SlowListener m_slowListener;
+    };
+
+} // namespace easyprofile
@@ -0,0 +1,152 @@
+// Cost of changing profile values from several threads: ChangeQueue::post() drained by the
+// owner thread against the usual global mutex around Profile::set().
+//
+// Usage: bench-change-queue [max producer threads] [sets per producer]
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class U32
+{
+    Count = 1024
+};
+
+#define PROFILE_TYPES \
+    PROFILE_TYPE(U32, U32, uint32_t, static_cast<size_t>(U32::Count))
+
+#include "EasyProfile.h"
+#include "EasyProfileQueue.h"
+
+namespace
+{
+    std::array<uint32_t, static_cast<size_t>(U32::Count)> defaultU32{};
+
+    class BenchProfile final : public easyprofile::Profile
+    {
+    public:
+        BenchProfile()
+            : easyprofile::Profile(defaultU32)
+        {
+        }
+    };
+
+    // Counts notifications, so both variants do the same work per applied change.
+    class CountingListener final : public easyprofile::Profile::Listener
+    {
+    public:
+        explicit CountingListener(easyprofile::Profile* profile)
+            : easyprofile::Profile::Listener(profile, "CountingListener")
+        {
+        }
+
+        void onProfile(U32 e, const uint32_t& value) override
+        {
+            (void)e;
+            (void)value;
+            count++;
+        }
+
+        size_t count = 0;
+    };
+
+    uint32_t Random(uint32_t& seed)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    // Returns nanoseconds per set() as seen by producers.
+    template <typename Post>
+    double RunProducers(unsigned threads, uint32_t sets, Post&& post)
+    {
+        std::vector<std::thread> producers;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned t = 0; t < threads; t++)
+        {
+            producers.emplace_back([&, t] {
+                uint32_t seed = 2463534242u + t;
+                for (uint32_t i = 0; i < sets; i++)
+                {
+                    auto r = Random(seed);
+                    post(static_cast<U32>(r % static_cast<uint32_t>(U32::Count)), r);
+                }
+            });
+        }
+        for (auto& producer : producers)
+        {
+            producer.join();
+        }
+        auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return ns / (static_cast<double>(threads) * sets);
+    }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned maxThreads = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : std::thread::hardware_concurrency();
+    maxThreads = maxThreads != 0 ? maxThreads : 1;
+    uint32_t sets = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 200000u;
+
+    ::printf("%10s %18s %18s %14s\n", "producers", "mutex ns/set", "queue ns/set", "queue drains");
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        double mutexNs;
+        {
+            BenchProfile profile;
+            CountingListener listener(&profile);
+            std::mutex mutex;
+            mutexNs = RunProducers(threads, sets, [&](U32 e, uint32_t value) {
+                std::lock_guard<std::mutex> lock(mutex);
+                profile.set(e, value);
+            });
+        }
+
+        double queueNs;
+        size_t drains = 0;
+        {
+            BenchProfile profile;
+            CountingListener listener(&profile);
+            easyprofile::ChangeQueue queue(profile, 4096);
+
+            // The owner thread keeps draining while producers post.
+            std::atomic<bool> stop = false;
+            std::thread owner([&] {
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    if (queue.drain() != 0)
+                    {
+                        drains++;
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+                queue.drain();
+            });
+
+            queueNs = RunProducers(threads, sets, [&](U32 e, uint32_t value) {
+                while (!queue.post(e, value))
+                {
+                    std::this_thread::yield();
+                }
+            });
+            stop = true;
+            owner.join();
+        }
+
+        ::printf("%10u %18.1f %18.1f %14zu\n", threads, mutexNs, queueNs, drains);
+    }
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+#!/bin/sh
+#
+# Compile time and code size of EasyProfile.h as the schema grows: generates a
+# PROFILE_TYPES schema of N types with K keys each (cycling through bool, uint32_t,
+# int64_t, float and std::string), a listener overriding every onProfile() and a
+# profile that calls get() and set() on every type, and compiles it.
+#
+# Prints one JSON Line per schema: wall seconds of the compile, .text bytes of the
+# object file and object file bytes.
+#
+# Usage: bench/compile_time.sh ["types..."] ["keys..."] [extra compiler flags]
+#   bench/compile_time.sh "1 10 30 60" "10 1000" -DEASY_PROFILE_CONCURRENT_READS
+#
+# CXX defaults to c++, CXXFLAGS to -std=c++20 -O2 -fno-rtti -fno-exceptions.
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+CXX=${CXX:-c++}
+CXXFLAGS=${CXXFLAGS:--std=c++20 -O2 -fno-rtti -fno-exceptions}
+TYPES=${1:-1 10 30 60}
+KEYS=${2:-10 1000}
+shift $(($# < 2 ? $# : 2))
+EXTRA="$*"
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+now()
+{
+    date +%s.%N
+}
+
+# Writes the translation unit of a schema of $1 types with $2 keys each.
+generate()
+{
+    types=$1
+    keys=$2
+    file=$WORK/profile_${types}_${keys}.cpp
+
+    {
+        printf '#include <array>\n#include <cstdint>\n#include <string>\n\n'
+
+        t=0
+        while [ $t -lt "$types" ]; do
+            printf 'enum class E%d\n{\n    Count = %d\n};\n\n' $t "$keys"
+            t=$((t + 1))
+        done
+
+        printf '#define PROFILE_TYPES'
+        t=0
+        while [ $t -lt "$types" ]; do
+            case $((t % 5)) in
+            0) type=bool ;;
+            1) type=uint32_t ;;
+            2) type=int64_t ;;
+            3) type=float ;;
+            4) type=std::string ;;
+            esac
+            printf ' \\\n    PROFILE_TYPE(E%d, T%d, %s, %d)' $t $t "$type" "$keys"
+            t=$((t + 1))
+        done
+        printf '\n\n#include "EasyProfile.h"\n\n'
+
+        printf '#define PROFILE_TYPE(Enum, Name, Type, Size) \\\n'
+        printf '    std::array<Type, Size> default##Name{};\n\nPROFILE_TYPES\n\n#undef PROFILE_TYPE\n\n'
+
+        cat <<'EOF'
+class GeneratedProfile final : public easyprofile::Profile
+{
+public:
+    GeneratedProfile()
+        : easyprofile::Profile(
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    default##Name,
+
+              PROFILE_TYPES
+
+#undef PROFILE_TYPE
+              0)
+    {
+    }
+};
+
+class GeneratedListener final : public easyprofile::Profile::ListenerT<GeneratedListener>
+{
+public:
+    explicit GeneratedListener(easyprofile::Profile* profile)
+        : easyprofile::Profile::ListenerT<GeneratedListener>(profile, "GeneratedListener")
+    {
+    }
+
+#define PROFILE_TYPE(Enum, Name, Type, Size)   \
+    void onProfile(Enum, const Type&) override \
+    {                                          \
+        m_count++;                             \
+    }
+
+    PROFILE_TYPES
+
+#undef PROFILE_TYPE
+
+    size_t m_count = 0;
+};
+
+size_t Run(easyprofile::Profile& profile, size_t key)
+{
+    GeneratedListener listener(&profile);
+    {
+        easyprofile::Profile::Batch batch(profile);
+
+#define PROFILE_TYPE(Enum, Name, Type, Size)            \
+    profile.set(static_cast<Enum>(key % Size), Type{}); \
+    profile.set(static_cast<Enum>(key % Size), profile.get(static_cast<Enum>(0)));
+
+        PROFILE_TYPES
+
+#undef PROFILE_TYPE
+    }
+    return listener.m_count + (profile.isDirty() ? 1 : 0);
+}
+
+int main(int argc, char**)
+{
+    GeneratedProfile profile;
+    return static_cast<int>(Run(profile, static_cast<size_t>(argc)));
+}
+EOF
+    } >"$file"
+
+    echo "$file"
+}
+
+for types in $TYPES; do
+    for keys in $KEYS; do
+        file=$(generate "$types" "$keys")
+        object=${file%.cpp}.o
+
+        start=$(now)
+        # shellcheck disable=SC2086
+        $CXX $CXXFLAGS $EXTRA -I"$ROOT" -c "$file" -o "$object"
+        end=$(now)
+
+        text=$(size -A "$object" | awk '$1 ~ /^\.text/ { sum += $2 } END { print sum + 0 }')
+        bytes=$(wc -c <"$object" | tr -d ' ')
+        seconds=$(awk -v s="$start" -v e="$end" 'BEGIN { printf "%.2f", e - s }')
+
+        printf '{"types":%d,"keys":%d,"seconds":%s,"text_bytes":%d,"object_bytes":%d}\n' \
+            "$types" "$keys" "$seconds" "$text" "$bytes"
+    done
+done
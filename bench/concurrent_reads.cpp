@@ -0,0 +1,197 @@
+// Reader throughput of Profile::fetch() against a mutex guarded get(), while the owner
+// thread keeps setting values. Also checks that multi-word values are never torn and
+// that pinned strings stay intact while they are replaced.
+//
+// Usage: bench-concurrent-reads [max reader threads] [milliseconds per run]
+
+#define EASY_PROFILE_CONCURRENT_READS
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class U32
+{
+    Count = 1024
+};
+
+enum class VEC
+{
+    Count = 64
+};
+
+enum class STR
+{
+    Count = 64
+};
+
+struct Vec3
+{
+    uint64_t x;
+    uint64_t y;
+    uint64_t z;
+
+    bool operator==(const Vec3&) const = default;
+};
+
+#define PROFILE_TYPES                                                 \
+    PROFILE_TYPE(U32, U32, uint32_t, static_cast<size_t>(U32::Count)) \
+    PROFILE_TYPE(VEC, Vec, Vec3, static_cast<size_t>(VEC::Count))     \
+    PROFILE_TYPE(STR, Str, std::string, static_cast<size_t>(STR::Count))
+
+#include "EasyProfile.h"
+
+namespace
+{
+    std::array<uint32_t, static_cast<size_t>(U32::Count)> defaultU32{};
+    std::array<Vec3, static_cast<size_t>(VEC::Count)> defaultVec{};
+    std::array<std::string, static_cast<size_t>(STR::Count)> defaultStr{};
+
+    class BenchProfile final : public easyprofile::Profile
+    {
+    public:
+        BenchProfile()
+            : easyprofile::Profile(defaultU32, defaultVec, defaultStr)
+        {
+        }
+    };
+
+    uint32_t Random(uint32_t& seed)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    // Runs `threads` readers for the given time while this thread writes, returns reads/s.
+    template <typename Read, typename Write>
+    double Run(unsigned threads, std::chrono::milliseconds duration, Read&& read, Write&& write)
+    {
+        std::atomic<bool> stop = false;
+        std::atomic<uint64_t> total = 0;
+        std::atomic<uint64_t> checksum = 0;
+
+        std::vector<std::thread> readers;
+        for (unsigned t = 0; t < threads; t++)
+        {
+            readers.emplace_back([&, t] {
+                uint32_t seed = 2463534242u + t;
+                uint64_t reads = 0;
+                uint64_t sum = 0;
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    sum += read(Random(seed));
+                    reads++;
+                }
+                total += reads;
+                checksum += sum;
+            });
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        uint32_t seed = 88675123u;
+        while (std::chrono::steady_clock::now() - start < duration)
+        {
+            write(Random(seed));
+            // Settings change far less often than they are read.
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        stop = true;
+
+        for (auto& reader : readers)
+        {
+            reader.join();
+        }
+
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return static_cast<double>(total.load()) / seconds;
+    }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned maxThreads = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : std::thread::hardware_concurrency();
+    maxThreads = maxThreads != 0 ? maxThreads : 1;
+    std::chrono::milliseconds duration(argc > 2 ? std::atoi(argv[2]) : 300);
+
+    BenchProfile profile;
+    std::mutex mutex;
+
+    // Torn read check: every Vec3 is written with equal components.
+    {
+        std::atomic<uint64_t> torn = 0;
+        auto reads = Run(
+            maxThreads, duration,
+            [&](uint32_t r) {
+                auto v = profile.fetch(static_cast<VEC>(r % static_cast<uint32_t>(VEC::Count)));
+                if (v.x != v.y || v.y != v.z)
+                {
+                    torn++;
+                }
+                return v.x;
+            },
+            [&](uint32_t r) {
+                profile.set(static_cast<VEC>(r % static_cast<uint32_t>(VEC::Count)), Vec3{ r, r, r });
+            });
+        ::printf("Vec3 fetch: %.1f M reads/s, torn reads: %llu\n", reads / 1e6,
+                 static_cast<unsigned long long>(torn.load()));
+    }
+
+    // Every string is a run of one letter, a reclaimed or torn version would break it.
+    {
+        std::atomic<uint64_t> broken = 0;
+        auto reads = Run(
+            maxThreads, duration,
+            [&](uint32_t r) {
+                auto value = profile.pin(static_cast<STR>(r % static_cast<uint32_t>(STR::Count)));
+                if (!value->empty() && value->find_first_not_of(value->front()) != std::string::npos)
+                {
+                    broken++;
+                }
+                return value->size();
+            },
+            [&](uint32_t r) {
+                profile.set(static_cast<STR>(r % static_cast<uint32_t>(STR::Count)),
+                            std::string(16 + r % 48, static_cast<char>('a' + r % 26)));
+            });
+        ::printf("String pin: %.1f M reads/s, broken reads: %llu\n\n", reads / 1e6,
+                 static_cast<unsigned long long>(broken.load()));
+    }
+
+    ::printf("%8s %18s %18s\n", "readers", "fetch() M/s", "mutex get() M/s");
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        auto fetchReads = Run(
+            threads, duration,
+            [&](uint32_t r) {
+                return profile.fetch(static_cast<U32>(r % static_cast<uint32_t>(U32::Count)));
+            },
+            [&](uint32_t r) {
+                profile.set(static_cast<U32>(r % static_cast<uint32_t>(U32::Count)), r);
+            });
+
+        auto mutexReads = Run(
+            threads, duration,
+            [&](uint32_t r) {
+                std::lock_guard<std::mutex> lock(mutex);
+                return profile.get(static_cast<U32>(r % static_cast<uint32_t>(U32::Count)));
+            },
+            [&](uint32_t r) {
+                std::lock_guard<std::mutex> lock(mutex);
+                profile.set(static_cast<U32>(r % static_cast<uint32_t>(U32::Count)), r);
+            });
+
+        ::printf("%8u %18.1f %18.1f\n", threads, fetchReads / 1e6, mutexReads / 1e6);
+    }
+
+    return 0;
+}
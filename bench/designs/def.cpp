@@ -0,0 +1,107 @@
+// experiments/def with BENCH_KEYS uint32_t keys, compiled once per key count (see
+// CMakeLists.txt). The design lives in an anonymous namespace, so the builds for different
+// key counts don't clash at link time.
+
+#include "harness.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#if !defined(BENCH_KEYS)
+#    error "BENCH_KEYS must be defined"
+#endif
+
+namespace
+{
+    enum class U32
+    {
+        Count = BENCH_KEYS
+    };
+
+#define PROFILE_TYPES \
+    PROFILE_TYPE(U32, U32, uint32_t, static_cast<size_t>(U32::Count))
+
+#include "def/include/Profile.h"
+
+    constexpr size_t KeysCount = static_cast<size_t>(U32::Count);
+
+    const auto defaultU32 = [] {
+        std::array<uint32_t, KeysCount> defaults;
+        for (size_t i = 0; i < KeysCount; i++)
+        {
+            defaults[i] = static_cast<uint32_t>(i);
+        }
+        return defaults;
+    }();
+
+    class CountingListener final : public profile::Profile::Listener
+    {
+    public:
+        explicit CountingListener(profile::Profile* profile)
+            : profile::Profile::Listener(profile, "Counting")
+        {
+        }
+
+        void onProfile(U32, const uint32_t&) override
+        {
+            m_count++;
+        }
+
+        size_t m_count = 0;
+    };
+
+    struct Adapter
+    {
+        class Profile final : public profile::Profile
+        {
+        public:
+            Profile()
+                : profile::Profile(defaultU32)
+            {
+            }
+
+        private:
+            // Listeners come and go in every suite, the experiments would log each of them.
+            void logListenerAdded(const Listener*, size_t) const override
+            {
+            }
+
+            void logListenerRemoved(const Listener*, size_t) const override
+            {
+            }
+        };
+
+        using Listener = profile::Profile::Listener;
+
+        static std::unique_ptr<Profile> create()
+        {
+            return std::make_unique<Profile>();
+        }
+
+        static uint32_t get(const Profile& profile, uint32_t key)
+        {
+            return profile.get(static_cast<U32>(key));
+        }
+
+        static void set(Profile& profile, uint32_t key, uint32_t value)
+        {
+            profile.set(static_cast<U32>(key), value);
+        }
+
+        static std::unique_ptr<Listener> listen(Profile& profile)
+        {
+            return std::make_unique<CountingListener>(&profile);
+        }
+    };
+
+    const bench::Register registerDef("def", KeysCount, [](bench::Results& results, double scale) {
+        bench::Run<Adapter>("def", KeysCount, results, scale);
+    });
+
+} // namespace
@@ -0,0 +1,166 @@
+// EasyProfile.h with BENCH_KEYS uint32_t keys, compiled once per key count and once more
+// with EASY_PROFILE_OVERLAY (see CMakeLists.txt). The library lives in an anonymous
+// namespace, so the builds for different key counts don't clash at link time.
+
+#include "harness.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    include <immintrin.h>
+#endif
+
+#if !defined(BENCH_KEYS)
+#    error "BENCH_KEYS must be defined"
+#endif
+
+#if defined(EASY_PROFILE_OVERLAY)
+#    define BENCH_DESIGN "easyprofile-overlay"
+#else
+#    define BENCH_DESIGN "easyprofile"
+#endif
+
+namespace
+{
+    enum class U32
+    {
+        Count = BENCH_KEYS
+    };
+
+#define PROFILE_TYPES \
+    PROFILE_TYPE(U32, U32, uint32_t, static_cast<size_t>(U32::Count))
+
+#include "EasyProfile.h"
+
+    constexpr size_t KeysCount = static_cast<size_t>(U32::Count);
+
+    const auto defaultU32 = [] {
+        std::array<uint32_t, KeysCount> defaults;
+        for (size_t i = 0; i < KeysCount; i++)
+        {
+            defaults[i] = static_cast<uint32_t>(i);
+        }
+        return defaults;
+    }();
+
+    const easyprofile::Profile::Defaults defaults(defaultU32);
+
+    class CountingListener final : public easyprofile::Profile::Listener
+    {
+    public:
+        explicit CountingListener(easyprofile::Profile* profile)
+            : easyprofile::Profile::Listener(profile, "Counting")
+        {
+        }
+
+        void onProfile(U32, const uint32_t&) override
+        {
+            m_count++;
+        }
+
+        size_t m_count = 0;
+    };
+
+    // Copies the defaults on construction.
+    struct Copied
+    {
+        class Profile final : public easyprofile::Profile
+        {
+        public:
+            Profile()
+                : easyprofile::Profile(defaultU32)
+            {
+            }
+        };
+
+        using Listener = easyprofile::Profile::Listener;
+
+        static std::unique_ptr<Profile> create()
+        {
+            return std::make_unique<Profile>();
+        }
+
+        static uint32_t get(const Profile& profile, uint32_t key)
+        {
+            return profile.get(static_cast<U32>(key));
+        }
+
+        static void set(Profile& profile, uint32_t key, uint32_t value)
+        {
+            profile.set(static_cast<U32>(key), value);
+        }
+
+        static std::unique_ptr<Listener> listen(Profile& profile)
+        {
+            return std::make_unique<CountingListener>(&profile);
+        }
+    };
+
+    // Shares Profile::Defaults until the first write.
+    struct Shared : Copied
+    {
+        class Profile final : public easyprofile::Profile
+        {
+        public:
+            Profile()
+                : easyprofile::Profile(defaults)
+            {
+            }
+        };
+
+        static std::unique_ptr<Profile> create()
+        {
+            return std::make_unique<Profile>();
+        }
+
+        static uint32_t get(const Profile& profile, uint32_t key)
+        {
+            return profile.get(static_cast<U32>(key));
+        }
+
+        static void set(Profile& profile, uint32_t key, uint32_t value)
+        {
+            profile.set(static_cast<U32>(key), value);
+        }
+
+        static std::unique_ptr<Listener> listen(Profile& profile)
+        {
+            return std::make_unique<CountingListener>(&profile);
+        }
+    };
+
+    const bench::Register registerCopied(BENCH_DESIGN, KeysCount, [](bench::Results& results, double scale) {
+        bench::Run<Copied>(BENCH_DESIGN, KeysCount, results, scale);
+    });
+
+#if !defined(EASY_PROFILE_OVERLAY)
+    // Overlay profiles always share the defaults.
+    const bench::Register registerShared(BENCH_DESIGN "-shared", KeysCount, [](bench::Results& results, double scale) {
+        bench::Run<Shared>(BENCH_DESIGN "-shared", KeysCount, results, scale);
+    });
+#endif
+
+} // namespace
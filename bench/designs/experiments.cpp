@@ -0,0 +1,278 @@
+// The template designs of experiments/: any, variant and strong, for every key count.
+// simple is left out, its Profile can't be constructed (no constructor, Entry has no default).
+
+#include "harness.h"
+
+#include <algorithm>
+#include <any>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <new>
+#include <string>
+#include <tuple>
+#include <variant>
+#include <vector>
+
+#if !defined(BENCH_KEY_COUNTS)
+#    error "BENCH_KEY_COUNTS must be defined"
+#endif
+
+namespace any
+{
+#include "any/include/Profile.h"
+} // namespace any
+
+namespace variant
+{
+#include "variant/include/Profile.h"
+} // namespace variant
+
+namespace strong
+{
+#include "strong/include/Profile.h"
+} // namespace strong
+
+namespace
+{
+    enum class U32
+    {
+    };
+
+    // std::array of entries without a default constructor, key i defaults to i. Built once
+    // per design and key count, and kept for the lifetime of the program.
+    template <typename Array, typename Make>
+    const Array& MakeEntries(Make&& make)
+    {
+        using Entry = typename Array::value_type;
+        auto* raw = ::operator new(sizeof(Array));
+        auto* entries = static_cast<Entry*>(raw);
+        for (size_t i = 0; i < std::tuple_size_v<Array>; i++)
+        {
+            new (entries + i) Entry(make(static_cast<uint32_t>(i)));
+        }
+        return *std::launder(static_cast<Array*>(raw));
+    }
+
+    // -------------------------------------------------------------------------
+
+    template <size_t Keys>
+    struct Any
+    {
+        static constexpr const char* Name = "any";
+
+        using Base = any::profile::Profile<U32, Keys>;
+        using Listener = typename Base::Listener;
+
+        class Profile final : public Base
+        {
+        public:
+            explicit Profile(const typename Base::Container& container)
+                : Base(container)
+            {
+            }
+
+        private:
+            // Listeners come and go in every suite, the experiments would log each of them.
+            void logListenerAdded(const Listener*, size_t) const override
+            {
+            }
+
+            void logListenerRemoved(const Listener*, size_t) const override
+            {
+            }
+        };
+
+        class CountingListener final : public Listener
+        {
+        public:
+            explicit CountingListener(Base* profile)
+                : Listener(profile, "Counting")
+            {
+            }
+
+            void onProfile(U32, const std::any&) override
+            {
+                m_count++;
+            }
+
+            size_t m_count = 0;
+        };
+
+        static std::unique_ptr<Profile> create()
+        {
+            static const auto& defaults = MakeEntries<typename Base::Container>([](uint32_t i) {
+                return any::profile::Entry("key", i);
+            });
+            return std::make_unique<Profile>(defaults);
+        }
+
+        static uint32_t get(const Profile& profile, uint32_t key)
+        {
+            return std::any_cast<uint32_t>(profile.get(static_cast<U32>(key)));
+        }
+
+        static void set(Profile& profile, uint32_t key, uint32_t value)
+        {
+            profile.set(static_cast<U32>(key), value);
+        }
+
+        static std::unique_ptr<Listener> listen(Profile& profile)
+        {
+            return std::make_unique<CountingListener>(&profile);
+        }
+    };
+
+    // -------------------------------------------------------------------------
+
+    template <size_t Keys>
+    struct Variant
+    {
+        static constexpr const char* Name = "variant";
+
+        using Base = variant::profile::Profile<U32, Keys, uint32_t>;
+        using Listener = typename Base::Listener;
+
+        class Profile final : public Base
+        {
+        public:
+            explicit Profile(const typename Base::Container& container)
+                : Base(container)
+            {
+            }
+
+        private:
+            // Listeners come and go in every suite, the experiments would log each of them.
+            void logListenerAdded(const Listener*, size_t) const override
+            {
+            }
+
+            void logListenerRemoved(const Listener*, size_t) const override
+            {
+            }
+        };
+
+        class CountingListener final : public Listener
+        {
+        public:
+            explicit CountingListener(Base* profile)
+                : Listener(profile, "Counting")
+            {
+            }
+
+            void onProfile(U32, const typename Base::Type&) override
+            {
+                m_count++;
+            }
+
+            size_t m_count = 0;
+        };
+
+        static std::unique_ptr<Profile> create()
+        {
+            static const auto& defaults = MakeEntries<typename Base::Container>([](uint32_t i) {
+                return typename Base::EntryType("key", i);
+            });
+            return std::make_unique<Profile>(defaults);
+        }
+
+        static uint32_t get(const Profile& profile, uint32_t key)
+        {
+            return std::get<uint32_t>(profile.get(static_cast<U32>(key)));
+        }
+
+        static void set(Profile& profile, uint32_t key, uint32_t value)
+        {
+            profile.set(static_cast<U32>(key), value);
+        }
+
+        static std::unique_ptr<Listener> listen(Profile& profile)
+        {
+            return std::make_unique<CountingListener>(&profile);
+        }
+    };
+
+    // -------------------------------------------------------------------------
+
+    // Listener::onProfile() of strong is an empty non-virtual template, so notify_N measures
+    // the loop over the listeners only.
+    template <size_t Keys>
+    struct Strong
+    {
+        static constexpr const char* Name = "strong";
+
+        using Container = strong::profile::Container<U32, uint32_t, Keys>;
+        using Base = strong::profile::Profile<Container>;
+        using Listener = typename Base::Listener;
+
+        class Profile final : public Base
+        {
+        public:
+            explicit Profile(const Container& container)
+                : Base(container)
+            {
+            }
+
+        private:
+            // Listeners come and go in every suite, the experiments would log each of them.
+            void logListenerAdded(const Listener*, size_t) const override
+            {
+            }
+
+            void logListenerRemoved(const Listener*, size_t) const override
+            {
+            }
+        };
+
+        class CountingListener final : public Listener
+        {
+        public:
+            explicit CountingListener(Base* profile)
+                : Listener(profile, "Counting")
+            {
+            }
+        };
+
+        static std::unique_ptr<Profile> create()
+        {
+            static const auto& defaults = MakeEntries<typename Container::ArrayType>([](uint32_t i) {
+                return typename Container::Entry("key", i);
+            });
+            return std::make_unique<Profile>(Container(defaults));
+        }
+
+        static uint32_t get(const Profile& profile, uint32_t key)
+        {
+            return profile.get(static_cast<U32>(key));
+        }
+
+        static void set(Profile& profile, uint32_t key, uint32_t value)
+        {
+            profile.set(static_cast<U32>(key), value);
+        }
+
+        static std::unique_ptr<Listener> listen(Profile& profile)
+        {
+            return std::make_unique<CountingListener>(&profile);
+        }
+    };
+
+    // -------------------------------------------------------------------------
+
+    template <template <size_t> typename Adapter, size_t... Keys>
+    bool RegisterAll()
+    {
+        (bench::Register(Adapter<Keys>::Name, Keys, [](bench::Results& results, double scale) {
+             bench::Run<Adapter<Keys>>(Adapter<Keys>::Name, Keys, results, scale);
+         }),
+         ...);
+        return true;
+    }
+
+    const bool registered = RegisterAll<Any, BENCH_KEY_COUNTS>() && RegisterAll<Variant, BENCH_KEY_COUNTS>()
+                            && RegisterAll<Strong, BENCH_KEY_COUNTS>();
+
+} // namespace
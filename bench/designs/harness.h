@@ -0,0 +1,166 @@
+// Shared harness of bench-profile-designs: every design registers one suite per key count,
+// suites run the same operations through a small adapter and report ns per operation.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+    struct Result
+    {
+        std::string design;
+        size_t keys;
+        std::string op;
+        double nsPerOp;
+        size_t ops;
+    };
+
+    using Results = std::vector<Result>;
+    using Suite = void (*)(Results& results, double scale);
+
+    struct SuiteInfo
+    {
+        const char* design;
+        size_t keys;
+        Suite run;
+    };
+
+    inline std::vector<SuiteInfo>& Suites()
+    {
+        static std::vector<SuiteInfo> list;
+        return list;
+    }
+
+    // Static registration, one object per design and key count.
+    struct Register
+    {
+        Register(const char* design, size_t keys, Suite run)
+        {
+            Suites().push_back({ design, keys, run });
+        }
+    };
+
+    inline uint32_t Random(uint32_t& seed)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    // Keys in random order, so reads aren't sequential; generated once per suite.
+    inline std::vector<uint32_t> RandomKeys(size_t keys)
+    {
+        std::vector<uint32_t> order(4096);
+        uint32_t seed = 2463534242u;
+        for (auto& key : order)
+        {
+            key = Random(seed) % static_cast<uint32_t>(keys);
+        }
+        return order;
+    }
+
+    // Best of three runs of func(ops), in ns per operation.
+    template <typename Func>
+    double Measure(size_t ops, Func&& func)
+    {
+        auto best = std::numeric_limits<double>::max();
+        for (int run = 0; run < 3; run++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            func(ops);
+            auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = std::min(best, seconds * 1e9 / static_cast<double>(ops));
+        }
+        return best;
+    }
+
+    // Keeps results from being optimized away.
+    inline volatile uint64_t Sink = 0;
+
+    // Adapter interface, all values are uint32_t and key i defaults to i:
+    //   using Profile, Listener;
+    //   static std::unique_ptr<Profile> create();
+    //   static uint32_t get(const Profile&, uint32_t key);
+    //   static void set(Profile&, uint32_t key, uint32_t value);
+    //   static std::unique_ptr<Listener> listen(Profile&);  // Counts onProfile() calls.
+    template <typename Adapter>
+    void Run(const char* design, size_t keys, Results& results, double scale)
+    {
+        auto scaled = [scale](double ops) {
+            return std::max<size_t>(16, static_cast<size_t>(ops * scale));
+        };
+        auto add = [&](const char* op, size_t ops, double ns) {
+            results.push_back({ design, keys, op, ns, ops });
+        };
+
+        auto order = RandomKeys(keys);
+        auto profile = Adapter::create();
+
+        auto constructs = scaled(std::clamp(double(1 << 24) / static_cast<double>(keys), 8.0, 100000.0));
+        add("construct", constructs, Measure(constructs, [](size_t ops) {
+                for (size_t i = 0; i < ops; i++)
+                {
+                    auto created = Adapter::create();
+                    Sink = Sink + Adapter::get(*created, 0);
+                }
+            }));
+
+        auto reads = scaled(1 << 22);
+        add("get", reads, Measure(reads, [&](size_t ops) {
+                uint64_t sum = 0;
+                for (size_t i = 0; i < ops; i++)
+                {
+                    sum += Adapter::get(*profile, order[i & 4095]);
+                }
+                Sink = Sink + sum;
+            }));
+
+        // Every key still holds its default.
+        auto writes = scaled(1 << 22);
+        add("set_unchanged", writes, Measure(writes, [&](size_t ops) {
+                for (size_t i = 0; i < ops; i++)
+                {
+                    auto key = order[i & 4095];
+                    Adapter::set(*profile, key, key);
+                }
+            }));
+
+        // A counter never repeats a value, every set() is a change.
+        uint32_t value = 1u << 31;
+        add("set_changed", writes, Measure(writes, [&](size_t ops) {
+                for (size_t i = 0; i < ops; i++)
+                {
+                    Adapter::set(*profile, order[i & 4095], value++);
+                }
+            }));
+
+        // notify_0, a change with no listener registered, is the baseline of the series.
+        for (size_t count : { 0u, 1u, 16u, 256u })
+        {
+            std::vector<std::unique_ptr<typename Adapter::Listener>> listeners;
+            for (size_t l = 0; l < count; l++)
+            {
+                listeners.push_back(Adapter::listen(*profile));
+            }
+
+            auto notifies = scaled(double(1 << 22) / static_cast<double>(std::max<size_t>(count, 1)));
+            auto op = "notify_" + std::to_string(count);
+            add(op.c_str(), notifies, Measure(notifies, [&](size_t ops) {
+                    for (size_t i = 0; i < ops; i++)
+                    {
+                        Adapter::set(*profile, order[i & 4095], value++);
+                    }
+                }));
+        }
+    }
+
+} // namespace bench
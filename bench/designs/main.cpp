@@ -0,0 +1,46 @@
+// Compares the profile designs of experiments/ and EasyProfile.h: construction, get(),
+// set() of an unchanged and a changed value, and set() with 0, 1, 16 and 256 listeners,
+// for 8 to 100000 uint32_t keys. Prints one JSON object per design, key count and
+// operation (JSON Lines), e.g.
+//   {"design":"def","keys":1000,"op":"get","ns_per_op":1.23,"ops":4194304}
+//
+// Usage: bench-profile-designs [design prefix] [scale of the operation counts]
+
+#include "harness.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <tuple>
+
+int main(int argc, char** argv)
+{
+    const char* filter = argc > 1 ? argv[1] : "";
+    double scale = argc > 2 ? std::atof(argv[2]) : 1.0;
+
+    auto suites = bench::Suites();
+    std::sort(suites.begin(), suites.end(), [](const bench::SuiteInfo& a, const bench::SuiteInfo& b) {
+        return std::make_tuple(std::string(a.design), a.keys) < std::make_tuple(std::string(b.design), b.keys);
+    });
+
+    for (const auto& suite : suites)
+    {
+        if (std::strncmp(suite.design, filter, std::strlen(filter)) != 0)
+        {
+            continue;
+        }
+
+        bench::Results results;
+        suite.run(results, scale);
+        for (const auto& result : results)
+        {
+            ::printf("{\"design\":\"%s\",\"keys\":%zu,\"op\":\"%s\",\"ns_per_op\":%.3f,\"ops\":%zu}\n",
+                     result.design.c_str(), result.keys, result.op.c_str(), result.nsPerOp, result.ops);
+        }
+        ::fflush(stdout);
+    }
+
+    return 0;
+}
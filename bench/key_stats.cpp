@@ -0,0 +1,105 @@
+// Cost of per-key counters in a frame loop that reads most keys and rewrites a few of them
+// every frame, mostly with the value they already hold. Built twice, bench-key-stats-enabled
+// defines EASY_PROFILE_STATS and prints the stats() report.
+//
+// Usage: bench-key-stats [frames]
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+enum class U32
+{
+    Count = 1024
+};
+
+#define PROFILE_TYPES \
+    PROFILE_TYPE(U32, U32, uint32_t, static_cast<size_t>(U32::Count))
+
+#include "EasyProfile.h"
+
+namespace
+{
+    constexpr size_t KeysCount = static_cast<size_t>(U32::Count);
+
+    std::array<uint32_t, KeysCount> defaultU32{};
+
+    class BenchProfile final : public easyprofile::Profile
+    {
+    public:
+        BenchProfile()
+            : easyprofile::Profile(defaultU32)
+        {
+        }
+    };
+
+    class CountingListener final : public easyprofile::Profile::Listener
+    {
+    public:
+        explicit CountingListener(easyprofile::Profile* profile)
+            : easyprofile::Profile::Listener(profile, "Counting")
+        {
+        }
+
+        void onProfile(U32, const uint32_t&) override
+        {
+            m_count++;
+        }
+
+        size_t m_count = 0;
+    };
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t frames = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 100000;
+
+#if defined(EASY_PROFILE_STATS)
+    const char* mode = "stats";
+#else
+    const char* mode = "no stats";
+#endif
+
+    auto profile = std::make_unique<BenchProfile>();
+    CountingListener listener(profile.get());
+
+    // Every frame reads all keys, writes the first 16 with a value that changes once
+    // every 64 frames, and key 100 with the frame number.
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t frame = 0; frame < frames; frame++)
+    {
+        for (size_t i = 0; i < KeysCount; i++)
+        {
+            sum += profile->get(static_cast<U32>(i));
+        }
+        for (size_t i = 0; i < 16; i++)
+        {
+            profile->set(static_cast<U32>(i), static_cast<uint32_t>(frame / 64 + i));
+        }
+        profile->set(static_cast<U32>(100), static_cast<uint32_t>(frame));
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::printf("%s: %.2f us per frame, %zu notifications (checksum %llu)\n", mode,
+             seconds * 1e6 / static_cast<double>(frames), listener.m_count, static_cast<unsigned long long>(sum));
+
+#if defined(EASY_PROFILE_STATS)
+    auto stats = profile->stats(5);
+    ::printf("%s: %llu gets, %llu sets, %.1f%% wasted\n", mode, static_cast<unsigned long long>(stats.total.gets),
+             static_cast<unsigned long long>(stats.total.sets), stats.wastedSetRatio() * 100.0);
+    ::printf("%-8s %12s %12s %12s %12s\n", "key", "gets", "sets", "wasted", "notifies");
+    for (const auto& hot : stats.hotKeys)
+    {
+        ::printf("U32[%-3u] %12llu %12llu %12llu %12llu\n", hot.key.index,
+                 static_cast<unsigned long long>(hot.stats.gets), static_cast<unsigned long long>(hot.stats.sets),
+                 static_cast<unsigned long long>(hot.stats.wastedSets()),
+                 static_cast<unsigned long long>(hot.stats.notifies));
+    }
+#endif
+
+    return 0;
+}
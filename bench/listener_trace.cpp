@@ -0,0 +1,156 @@
+// Cost of listener tracing per notification, and attribution of a slow listener by name.
+// Built twice, bench-listener-trace-enabled defines EASY_PROFILE_TRACE, attaches a Tracer
+// while another thread reads its samples, reports calls over budget and writes the Chrome
+// trace to listener_trace.json.
+//
+// Usage: bench-listener-trace [sets]
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+enum class U32
+{
+    Count = 1024
+};
+
+#define PROFILE_TYPES \
+    PROFILE_TYPE(U32, U32, uint32_t, static_cast<size_t>(U32::Count))
+
+#include "EasyProfile.h"
+
+namespace
+{
+    constexpr size_t KeysCount = static_cast<size_t>(U32::Count);
+
+    std::array<uint32_t, KeysCount> defaultU32{};
+
+    class BenchProfile final : public easyprofile::Profile
+    {
+    public:
+        BenchProfile()
+            : easyprofile::Profile(defaultU32)
+        {
+        }
+    };
+
+    class FastListener final : public easyprofile::Profile::Listener
+    {
+    public:
+        FastListener(easyprofile::Profile* profile, const char* name)
+            : easyprofile::Profile::Listener(profile, name)
+        {
+        }
+
+        void onProfile(U32, const uint32_t& value) override
+        {
+            m_sum += value;
+        }
+
+        uint64_t m_sum = 0;
+    };
+
+    // Busy for about 50 us on every 1000th key.
+    class SlowListener final : public easyprofile::Profile::Listener
+    {
+    public:
+        explicit SlowListener(easyprofile::Profile* profile)
+            : easyprofile::Profile::Listener(profile, "SlowListener")
+        {
+        }
+
+        void onProfile(U32 e, const uint32_t&) override
+        {
+            if (static_cast<size_t>(e) % 1000 == 999)
+            {
+                auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(50);
+                while (std::chrono::steady_clock::now() < until)
+                {
+                }
+            }
+        }
+    };
+
+    // ns per set(), every set() changes its key and notifies all listeners.
+    double Run(BenchProfile& profile, size_t sets, uint32_t& value)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < sets; i++)
+        {
+            profile.set(static_cast<U32>(i % KeysCount), value++);
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9
+             / static_cast<double>(sets);
+    }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t sets = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 1000000;
+
+    auto profile = std::make_unique<BenchProfile>();
+    FastListener first(profile.get(), "FirstListener");
+    FastListener second(profile.get(), "SecondListener");
+    FastListener third(profile.get(), "ThirdListener");
+
+    uint32_t value = 1;
+    ::printf("%s: %.1f ns per set() with 3 listeners\n",
+#if defined(EASY_PROFILE_TRACE)
+             "no tracer",
+#else
+             "compiled out",
+#endif
+             Run(*profile, sets, value));
+
+#if defined(EASY_PROFILE_TRACE)
+    easyprofile::Tracer tracer(1 << 16);
+    profile->setTracer(&tracer);
+    ::printf("tracer: %.1f ns per set() with 3 listeners\n", Run(*profile, sets, value));
+
+    size_t slowCalls = 0;
+    const char* slowName = "";
+    tracer.setSlowListener(std::chrono::microseconds(20), [&](const easyprofile::TraceSample& sample) {
+        slowCalls++;
+        slowName = sample.listener;
+    });
+    tracer.clear();
+
+    std::atomic<bool> done{ false };
+    size_t read = 0;
+    std::thread reader([&] {
+        while (!done.load(std::memory_order_relaxed))
+        {
+            read += tracer.samples().size();
+        }
+    });
+
+    SlowListener slow(profile.get());
+    Run(*profile, 20000, value);
+
+    done = true;
+    reader.join();
+
+    ::printf("tracer: %zu calls over 20 us budget, last by %s; %zu samples read concurrently, %llu dropped\n",
+             slowCalls, slowName, read, static_cast<unsigned long long>(tracer.dropped()));
+
+    easyprofile::VectorWriter writer;
+    tracer.writeChromeTrace(writer);
+    if (auto* file = ::fopen("listener_trace.json", "wb"))
+    {
+        ::fwrite(writer.data().data(), 1, writer.data().size(), file);
+        ::fclose(file);
+        ::printf("tracer: %zu samples, %zu bytes written to listener_trace.json\n", tracer.samples().size(),
+                 writer.data().size());
+    }
+
+    profile->setTracer(nullptr);
+#endif
+
+    return 0;
+}
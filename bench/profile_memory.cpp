@@ -0,0 +1,200 @@
+// Memory per profile, get(), forEachNonDefault() and resetAll() cost with full copies of the
+// defaults against overlay profiles sharing them. Built twice, bench-profile-memory-overlay
+// defines EASY_PROFILE_OVERLAY.
+//
+// Usage: bench-profile-memory [profiles] [overridden keys per mille]
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+enum class U32
+{
+    Count = 1024
+};
+
+enum class F32
+{
+    Count = 256
+};
+
+enum class STR
+{
+    Count = 256
+};
+
+#define PROFILE_TYPES                                                 \
+    PROFILE_TYPE(U32, U32, uint32_t, static_cast<size_t>(U32::Count)) \
+    PROFILE_TYPE(F32, F32, float, static_cast<size_t>(F32::Count))    \
+    PROFILE_TYPE(STR, Str, std::string, static_cast<size_t>(STR::Count))
+
+#include "EasyProfile.h"
+
+namespace
+{
+    size_t heapBytes = 0;
+
+    // Every allocation keeps its size in front of the block.
+    constexpr size_t HeaderSize = alignof(std::max_align_t);
+
+    void* Allocate(size_t size)
+    {
+        auto* block = static_cast<unsigned char*>(std::malloc(size + HeaderSize));
+        if (block == nullptr)
+        {
+            std::abort();
+        }
+        *reinterpret_cast<size_t*>(block) = size;
+        heapBytes += size;
+        return block + HeaderSize;
+    }
+
+    void Free(void* ptr)
+    {
+        if (ptr != nullptr)
+        {
+            auto* block = static_cast<unsigned char*>(ptr) - HeaderSize;
+            heapBytes -= *reinterpret_cast<size_t*>(block);
+            std::free(block);
+        }
+    }
+
+    template <typename Type, size_t Size>
+    std::array<Type, Size> MakeDefaults()
+    {
+        std::array<Type, Size> defaults;
+        for (size_t i = 0; i < Size; i++)
+        {
+            if constexpr (std::is_same_v<Type, std::string>)
+            {
+                defaults[i] = "default value of key " + std::to_string(i);
+            }
+            else
+            {
+                defaults[i] = static_cast<Type>(i);
+            }
+        }
+        return defaults;
+    }
+
+    const auto defaultU32 = MakeDefaults<uint32_t, static_cast<size_t>(U32::Count)>();
+    const auto defaultF32 = MakeDefaults<float, static_cast<size_t>(F32::Count)>();
+    const auto defaultStr = MakeDefaults<std::string, static_cast<size_t>(STR::Count)>();
+
+    class BenchProfile final : public easyprofile::Profile
+    {
+    public:
+        BenchProfile()
+            : easyprofile::Profile(defaultU32, defaultF32, defaultStr)
+        {
+        }
+    };
+
+    uint32_t Random(uint32_t& seed)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+} // namespace
+
+void* operator new(size_t size)
+{
+    return Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    Free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    Free(ptr);
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 10000;
+    uint32_t perMille = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 10;
+
+#if defined(EASY_PROFILE_OVERLAY)
+    const char* mode = "overlay";
+#else
+    const char* mode = "dense";
+#endif
+
+    auto before = heapBytes;
+    std::vector<std::unique_ptr<BenchProfile>> profiles;
+    profiles.reserve(count);
+    auto reserved = heapBytes - before;
+
+    uint32_t seed = 2463534242u;
+    size_t overrides = 0;
+    for (size_t p = 0; p < count; p++)
+    {
+        auto& profile = *profiles.emplace_back(std::make_unique<BenchProfile>());
+        for (size_t i = 0; i < static_cast<size_t>(U32::Count); i++)
+        {
+            if (Random(seed) % 1000 < perMille)
+            {
+                profile.set(static_cast<U32>(i), Random(seed));
+                overrides++;
+            }
+        }
+        for (size_t i = 0; i < static_cast<size_t>(STR::Count); i++)
+        {
+            if (Random(seed) % 1000 < perMille)
+            {
+                profile.set(static_cast<STR>(i), "user value " + std::to_string(Random(seed)));
+                overrides++;
+            }
+        }
+    }
+
+    auto bytes = heapBytes - before - reserved;
+    ::printf("%s: %zu profiles, %zu overridden keys, %.0f bytes per profile\n", mode, count, overrides,
+             static_cast<double>(bytes) / static_cast<double>(count));
+
+    const size_t reads = 20'000'000;
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < reads; r++)
+    {
+        auto rnd = Random(seed);
+        sum += profiles[rnd % count]->get(static_cast<U32>((rnd >> 16) % static_cast<uint32_t>(U32::Count)));
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::printf("%s: get() %.2f ns (checksum %llu)\n", mode, seconds * 1e9 / static_cast<double>(reads),
+             static_cast<unsigned long long>(sum));
+
+    size_t nonDefault = 0;
+    start = std::chrono::steady_clock::now();
+    for (const auto& profile : profiles)
+    {
+        profile->forEachNonDefault([&nonDefault](auto, const auto&) {
+            nonDefault++;
+        });
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::printf("%s: forEachNonDefault() %.2f us per profile, %zu keys\n", mode,
+             seconds * 1e6 / static_cast<double>(count), nonDefault);
+
+    start = std::chrono::steady_clock::now();
+    for (const auto& profile : profiles)
+    {
+        profile->resetAll(false);
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::printf("%s: resetAll() %.2f us per profile\n", mode, seconds * 1e6 / static_cast<double>(count));
+
+    return 0;
+}
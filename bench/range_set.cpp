@@ -0,0 +1,131 @@
+// Importing a large container: one set() per key, set() inside a Batch and setRange(),
+// with a listener subscribed to every key.
+//
+// Usage: bench-range-set [changed keys per mille]
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <span>
+#include <vector>
+
+enum class U32
+{
+    Count = 1 << 16
+};
+
+#define PROFILE_TYPES \
+    PROFILE_TYPE(U32, U32, uint32_t, static_cast<size_t>(U32::Count))
+
+#include "EasyProfile.h"
+
+namespace
+{
+    constexpr size_t KeysCount = static_cast<size_t>(U32::Count);
+
+    std::array<uint32_t, KeysCount> defaultU32{};
+
+    class BenchProfile final : public easyprofile::Profile
+    {
+    public:
+        BenchProfile()
+            : easyprofile::Profile(defaultU32)
+        {
+        }
+    };
+
+    class CountingListener final : public easyprofile::Profile::Listener
+    {
+    public:
+        explicit CountingListener(easyprofile::Profile* profile)
+            : easyprofile::Profile::Listener(profile, "Counting")
+        {
+        }
+
+        void onProfile(U32, const uint32_t&) override
+        {
+            m_count++;
+        }
+
+        void onProfileBatch(std::span<const easyprofile::Profile::Key> keys) override
+        {
+            m_count += keys.size();
+        }
+
+        size_t m_count = 0;
+    };
+
+    uint32_t Random(uint32_t& seed)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    // Runs import(values) on fresh profiles, returns ns per key and the notified keys.
+    template <typename Import>
+    std::pair<double, size_t> Run(const std::vector<uint32_t>& values, Import&& import)
+    {
+        const size_t rounds = 50;
+        double seconds = 0.0;
+        size_t notified = 0;
+        for (size_t r = 0; r < rounds; r++)
+        {
+            auto profile = std::make_unique<BenchProfile>();
+            CountingListener listener(profile.get());
+
+            auto start = std::chrono::steady_clock::now();
+            import(*profile, values);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            notified = listener.m_count;
+        }
+        return { seconds * 1e9 / static_cast<double>(rounds * values.size()), notified };
+    }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t perMille = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 10;
+
+    uint32_t seed = 2463534242u;
+    std::vector<uint32_t> values(KeysCount, 0u);
+    for (auto& value : values)
+    {
+        if (Random(seed) % 1000 < perMille)
+        {
+            value = Random(seed) | 1u;
+        }
+    }
+
+    auto perKey = Run(values, [](BenchProfile& profile, const std::vector<uint32_t>& v) {
+        for (size_t i = 0; i < v.size(); i++)
+        {
+            profile.set(static_cast<U32>(i), v[i]);
+        }
+    });
+
+    auto batched = Run(values, [](BenchProfile& profile, const std::vector<uint32_t>& v) {
+        easyprofile::Profile::Batch batch(profile);
+        for (size_t i = 0; i < v.size(); i++)
+        {
+            profile.set(static_cast<U32>(i), v[i]);
+        }
+    });
+
+    auto range = Run(values, [](BenchProfile& profile, const std::vector<uint32_t>& v) {
+        profile.setRange(U32{}, v);
+    });
+
+    ::printf("%zu keys, %u per mille changed\n", KeysCount, perMille);
+    ::printf("%-16s %10s %10s\n", "", "ns/key", "notified");
+    ::printf("%-16s %10.2f %10zu\n", "set()", perKey.first, perKey.second);
+    ::printf("%-16s %10.2f %10zu\n", "Batch + set()", batched.first, batched.second);
+    ::printf("%-16s %10.2f %10zu\n", "setRange()", range.first, range.second);
+
+    return 0;
+}
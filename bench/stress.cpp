@@ -0,0 +1,462 @@
+// Stress and scaling run of a production sized profile: STRESS_KEYS keys spread over
+// STRESS_TYPES types (set with cmake -DSTRESS_KEYS=... -DSTRESS_TYPES=1..4), hundreds of
+// listeners, and other threads reading through fetch() / pin() and writing through a
+// ChangeQueue while the owner thread runs a random mix of get(), set() and listener churn.
+//
+// Prints JSON Lines: throughput and p50/p99 latency per operation (every 8th operation and
+// every drain is timed, the clock overhead is subtracted), then a summary with peak RSS.
+// Exits with 1 if a reader saw a torn value, so it can serve as a regression gate.
+//
+// Usage: bench-stress [listeners] [owner operations] [reader threads] [writer threads] [seed]
+
+#define EASY_PROFILE_CONCURRENT_READS
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if !defined(_WIN32)
+#    include <sys/resource.h>
+#endif
+
+#if !defined(STRESS_KEYS)
+#    define STRESS_KEYS 20000
+#endif
+
+#if !defined(STRESS_TYPES)
+#    define STRESS_TYPES 4
+#endif
+
+#define KEYS_PER_TYPE (STRESS_KEYS / STRESS_TYPES)
+
+enum class U32
+{
+    Count = KEYS_PER_TYPE
+};
+
+enum class U64
+{
+    Count = KEYS_PER_TYPE
+};
+
+enum class F32
+{
+    Count = KEYS_PER_TYPE
+};
+
+enum class STR
+{
+    Count = KEYS_PER_TYPE
+};
+
+#if STRESS_TYPES == 1
+#    define PROFILE_TYPES \
+        PROFILE_TYPE(U32, U32, uint32_t, KEYS_PER_TYPE)
+#elif STRESS_TYPES == 2
+#    define PROFILE_TYPES                               \
+        PROFILE_TYPE(U32, U32, uint32_t, KEYS_PER_TYPE) \
+        PROFILE_TYPE(U64, U64, uint64_t, KEYS_PER_TYPE)
+#elif STRESS_TYPES == 3
+#    define PROFILE_TYPES                               \
+        PROFILE_TYPE(U32, U32, uint32_t, KEYS_PER_TYPE) \
+        PROFILE_TYPE(U64, U64, uint64_t, KEYS_PER_TYPE) \
+        PROFILE_TYPE(F32, F32, float, KEYS_PER_TYPE)
+#elif STRESS_TYPES == 4
+#    define PROFILE_TYPES                               \
+        PROFILE_TYPE(U32, U32, uint32_t, KEYS_PER_TYPE) \
+        PROFILE_TYPE(U64, U64, uint64_t, KEYS_PER_TYPE) \
+        PROFILE_TYPE(F32, F32, float, KEYS_PER_TYPE)    \
+        PROFILE_TYPE(STR, Str, std::string, KEYS_PER_TYPE)
+#else
+#    error "STRESS_TYPES must be 1 to 4"
+#endif
+
+#include "EasyProfile.h"
+#include "EasyProfileQueue.h"
+
+namespace
+{
+    constexpr size_t KeysPerType = KEYS_PER_TYPE;
+
+    uint32_t Random(uint32_t& seed)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    // Values of key k are always congruent to k modulo KeysPerType, so readers can tell a
+    // torn or misplaced value from a valid one.
+    template <typename Type>
+    Type MakeValue(size_t key, uint32_t round)
+    {
+        if constexpr (std::is_same_v<Type, std::string>)
+        {
+            return "value " + std::to_string(key) + " " + std::to_string(round);
+        }
+        else
+        {
+            return static_cast<Type>(key + KeysPerType * (round % 1024));
+        }
+    }
+
+    template <typename Type>
+    std::array<Type, KeysPerType> MakeDefaults()
+    {
+        std::array<Type, KeysPerType> defaults;
+        for (size_t i = 0; i < KeysPerType; i++)
+        {
+            defaults[i] = MakeValue<Type>(i, 0);
+        }
+        return defaults;
+    }
+
+    template <typename Enum>
+    struct ValueType;
+
+#define PROFILE_TYPE(Enum, Name, Type, Size)         \
+    const auto default##Name = MakeDefaults<Type>(); \
+                                                     \
+    template <>                                      \
+    struct ValueType<Enum>                           \
+    {                                                \
+        using type = Type;                           \
+    };
+
+    PROFILE_TYPES
+
+#undef PROFILE_TYPE
+
+    class StressProfile final : public easyprofile::Profile
+    {
+    public:
+        StressProfile()
+            : easyprofile::Profile(
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    default##Name,
+
+                  PROFILE_TYPES
+
+#undef PROFILE_TYPE
+                  0)
+        {
+        }
+    };
+
+    // Subscribed either to all keys, or to a few random disjoint ranges of keys.
+    class StressListener final : public easyprofile::Profile::Listener
+    {
+    public:
+        StressListener(easyprofile::Profile* profile, uint32_t& seed, bool allKeys)
+            : easyprofile::Profile::Listener(profile, allKeys ? "AllKeysListener" : "SelectedKeysListener",
+                                             allKeys ? Subscription::AllKeys : Subscription::SelectedKeys)
+        {
+            if (!allKeys)
+            {
+                // A key is subscribed once, each range starts past the previous one.
+                size_t from = 0;
+                for (uint32_t r = 0, ranges = 1 + Random(seed) % 4; r < ranges && from < KeysPerType; r++)
+                {
+                    auto first = from + Random(seed) % ((KeysPerType - from + 1) / 2);
+                    auto last = std::min<size_t>(KeysPerType, first + 1 + Random(seed) % 16);
+                    from = last;
+#define PROFILE_TYPE(Enum, Name, Type, Size) \
+    profile->subscribe(this, static_cast<Enum>(first), static_cast<Enum>(last));
+
+                    PROFILE_TYPES
+
+#undef PROFILE_TYPE
+                }
+            }
+        }
+
+#define PROFILE_TYPE(Enum, Name, Type, Size)                    \
+    void onProfile(Enum, const Type&) override                  \
+    {                                                           \
+        notifications.fetch_add(1u, std::memory_order_relaxed); \
+    }
+
+        PROFILE_TYPES
+
+#undef PROFILE_TYPE
+
+        static inline std::atomic<uint64_t> notifications{ 0u };
+    };
+
+    enum class Op
+    {
+        Get,
+        SetUnchanged,
+        SetChanged,
+        Churn,
+        Drain,
+
+        Count
+    };
+
+    constexpr const char* OpNames[] = { "get", "set_unchanged", "set_changed", "churn", "drain" };
+
+    struct OpStats
+    {
+        uint64_t count = 0;
+        double seconds = 0.0;
+        std::vector<uint32_t> samples;
+    };
+
+    uint64_t Now()
+    {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    }
+
+    // Median cost of reading the clock, subtracted from timed operations.
+    uint64_t ClockOverhead()
+    {
+        std::vector<uint64_t> costs(1000);
+        for (auto& cost : costs)
+        {
+            auto start = Now();
+            cost = Now() - start;
+        }
+        std::nth_element(costs.begin(), costs.begin() + 500, costs.end());
+        return costs[500];
+    }
+
+    uint32_t Percentile(std::vector<uint32_t>& samples, double p)
+    {
+        if (samples.empty())
+        {
+            return 0;
+        }
+        auto nth = samples.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(samples.size() - 1));
+        std::nth_element(samples.begin(), nth, samples.end());
+        return *nth;
+    }
+
+    // Calls func(Enum{}) for a random type of the schema.
+    template <typename Func>
+    void VisitRandomType(uint32_t& seed, Func&& func)
+    {
+        switch (Random(seed) % STRESS_TYPES)
+        {
+        case 0:
+            func(U32{});
+            break;
+#if STRESS_TYPES > 1
+        case 1:
+            func(U64{});
+            break;
+#endif
+#if STRESS_TYPES > 2
+        case 2:
+            func(F32{});
+            break;
+#endif
+#if STRESS_TYPES > 3
+        case 3:
+            func(STR{});
+            break;
+#endif
+        }
+    }
+
+    long PeakRssKb()
+    {
+#if defined(_WIN32)
+        return 0;
+#else
+        rusage usage{};
+        ::getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+#endif
+    }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t listenersCount = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 300;
+    size_t operations = argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 2000000;
+    size_t readersCount = argc > 3 ? static_cast<size_t>(std::atoi(argv[3])) : 2;
+    size_t writersCount = argc > 4 ? static_cast<size_t>(std::atoi(argv[4])) : 2;
+    uint32_t seed = argc > 5 ? static_cast<uint32_t>(std::atoi(argv[5])) : 2463534242u;
+    seed = seed != 0 ? seed : 1;
+
+    auto profile = std::make_unique<StressProfile>();
+    constexpr size_t QueueCapacity = 4096;
+    easyprofile::ChangeQueue queue(*profile, QueueCapacity);
+
+    // One in ten listeners receives every change.
+    std::vector<std::unique_ptr<StressListener>> listeners;
+    for (size_t i = 0; i < listenersCount; i++)
+    {
+        listeners.push_back(std::make_unique<StressListener>(profile.get(), seed, i % 10 == 0));
+    }
+
+    std::atomic<bool> done{ false };
+    std::atomic<uint64_t> reads{ 0u };
+    std::atomic<uint64_t> torn{ 0u };
+    std::atomic<uint64_t> posts{ 0u };
+    std::atomic<uint64_t> rejected{ 0u };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < readersCount; t++)
+    {
+        threads.emplace_back([&, readerSeed = seed + static_cast<uint32_t>(t) * 7919u] {
+            auto localSeed = readerSeed;
+            uint64_t count = 0;
+            while (!done.load(std::memory_order_relaxed))
+            {
+                auto key = Random(localSeed) % KeysPerType;
+                if (profile->fetch(static_cast<U32>(key)) % KeysPerType != key)
+                {
+                    torn.fetch_add(1u, std::memory_order_relaxed);
+                }
+#if STRESS_TYPES > 3
+                auto name = profile->pin(static_cast<STR>(key));
+                if (name->empty())
+                {
+                    torn.fetch_add(1u, std::memory_order_relaxed);
+                }
+#endif
+                count++;
+            }
+            reads.fetch_add(count, std::memory_order_relaxed);
+        });
+    }
+
+    for (size_t t = 0; t < writersCount; t++)
+    {
+        threads.emplace_back([&, writerSeed = seed + static_cast<uint32_t>(t) * 104729u] {
+            auto localSeed = writerSeed;
+            uint64_t count = 0;
+            while (!done.load(std::memory_order_relaxed))
+            {
+                auto key = Random(localSeed) % KeysPerType;
+                if (queue.post(static_cast<U32>(key), MakeValue<uint32_t>(key, Random(localSeed))))
+                {
+                    count++;
+                }
+                else
+                {
+                    rejected.fetch_add(1u, std::memory_order_relaxed);
+                    std::this_thread::yield();
+                }
+            }
+            posts.fetch_add(count, std::memory_order_relaxed);
+        });
+    }
+
+    // Owner thread: 70% get(), 14% set() of the current value, 14% set() of a new one,
+    // 2% replacement of a random listener; the change queue is drained every 256 operations,
+    // at most one queue worth, so writers that post faster than the owner applies can't
+    // keep it there.
+    const auto overhead = ClockOverhead();
+    std::array<OpStats, static_cast<size_t>(Op::Count)> stats;
+    uint64_t checksum = 0;
+
+    auto run = [&](Op op, bool timed, auto&& func) {
+        auto& s = stats[static_cast<size_t>(op)];
+        s.count++;
+        if (!timed)
+        {
+            func();
+            return;
+        }
+        auto start = Now();
+        func();
+        auto elapsed = Now() - start;
+        s.samples.push_back(static_cast<uint32_t>(std::min<uint64_t>(elapsed - std::min(elapsed, overhead), UINT32_MAX)));
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < operations; i++)
+    {
+        bool timed = (i & 7) == 0;
+        auto dice = Random(seed) % 100;
+        auto key = Random(seed) % KeysPerType;
+
+        if ((i & 255) == 255)
+        {
+            run(Op::Drain, true, [&] {
+                queue.drain(QueueCapacity);
+            });
+        }
+        else if (dice < 70)
+        {
+            VisitRandomType(seed, [&](auto tag) {
+                run(Op::Get, timed, [&] {
+                    checksum += sizeof(profile->get(static_cast<decltype(tag)>(key)));
+                });
+            });
+        }
+        else if (dice < 84)
+        {
+            VisitRandomType(seed, [&](auto tag) {
+                auto e = static_cast<decltype(tag)>(key);
+                using Type = typename ValueType<decltype(tag)>::type;
+                Type current(profile->get(e));
+                run(Op::SetUnchanged, timed, [&] {
+                    profile->set(e, current);
+                });
+            });
+        }
+        else if (dice < 98)
+        {
+            VisitRandomType(seed, [&](auto tag) {
+                auto e = static_cast<decltype(tag)>(key);
+                using Type = typename ValueType<decltype(tag)>::type;
+                auto value = MakeValue<Type>(key, Random(seed));
+                run(Op::SetChanged, timed, [&] {
+                    profile->set(e, std::move(value));
+                });
+            });
+        }
+        else if (!listeners.empty())
+        {
+            auto& listener = listeners[Random(seed) % listeners.size()];
+            bool allKeys = Random(seed) % 10 == 0;
+            run(Op::Churn, timed, [&] {
+                listener.reset();
+                listener = std::make_unique<StressListener>(profile.get(), seed, allKeys);
+            });
+        }
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    done = true;
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    queue.drain();
+
+    for (size_t op = 0; op < stats.size(); op++)
+    {
+        auto& s = stats[op];
+        ::printf("{\"op\":\"%s\",\"count\":%llu,\"p50_ns\":%u,\"p99_ns\":%u,\"max_ns\":%u}\n", OpNames[op],
+                 static_cast<unsigned long long>(s.count), Percentile(s.samples, 0.5), Percentile(s.samples, 0.99),
+                 Percentile(s.samples, 1.0));
+    }
+
+    ::printf("{\"keys\":%zu,\"types\":%d,\"listeners\":%zu,\"readers\":%zu,\"writers\":%zu,\"seconds\":%.3f,"
+             "\"owner_ops_per_sec\":%.0f,\"reads_per_sec\":%.0f,\"posts_per_sec\":%.0f,\"rejected_posts\":%llu,"
+             "\"notifications\":%llu,\"torn_reads\":%llu,\"peak_rss_kb\":%ld,\"checksum\":%llu}\n",
+             KeysPerType * STRESS_TYPES, STRESS_TYPES, listenersCount, readersCount, writersCount, seconds,
+             static_cast<double>(operations) / seconds, static_cast<double>(reads.load()) / seconds,
+             static_cast<double>(posts.load()) / seconds, static_cast<unsigned long long>(rejected.load()),
+             static_cast<unsigned long long>(StressListener::notifications.load()),
+             static_cast<unsigned long long>(torn.load()), PeakRssKb(), static_cast<unsigned long long>(checksum));
+
+    return torn.load() == 0 ? 0 : 1;
+}
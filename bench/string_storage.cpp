@@ -0,0 +1,140 @@
+// Heap allocations, iteration and save() cost of profiles with thousands of strings, stored
+// as std::string or packed in an arena. Built twice, bench-string-storage-arena defines
+// EASY_PROFILE_STRING_ARENA.
+//
+// Usage: bench-string-storage [profiles] [rounds of updates]
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class STR
+{
+    Count = 4096
+};
+
+#define PROFILE_TYPES \
+    PROFILE_TYPE(STR, Str, std::string, static_cast<size_t>(STR::Count))
+
+#include "EasyProfile.h"
+
+namespace
+{
+    constexpr size_t KeysCount = static_cast<size_t>(STR::Count);
+
+    size_t allocations = 0;
+
+    const std::array<std::string, KeysCount> defaultStr{};
+
+    class BenchProfile final : public easyprofile::Profile
+    {
+    public:
+        BenchProfile()
+            : easyprofile::Profile(defaultStr)
+        {
+        }
+    };
+
+    uint32_t Random(uint32_t& seed)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    double Since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+} // namespace
+
+void* operator new(size_t size)
+{
+    allocations++;
+    if (void* ptr = std::malloc(size))
+    {
+        return ptr;
+    }
+    std::abort();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 100;
+    size_t rounds = argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 4;
+
+#if defined(EASY_PROFILE_STRING_ARENA)
+    const char* mode = "arena";
+#else
+    const char* mode = "std::string";
+#endif
+
+    std::vector<std::unique_ptr<BenchProfile>> profiles;
+    for (size_t p = 0; p < count; p++)
+    {
+        profiles.emplace_back(std::make_unique<BenchProfile>());
+    }
+
+    // Values longer than the small string buffer, updated with shorter and longer ones.
+    uint32_t seed = 2463534242u;
+    std::string value;
+    auto before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; r++)
+    {
+        for (auto& profile : profiles)
+        {
+            for (size_t i = 0; i < KeysCount; i++)
+            {
+                value.assign(24 + Random(seed) % 40, static_cast<char>('a' + r));
+                profile->set(static_cast<STR>(i), value, false);
+            }
+        }
+    }
+    auto setSeconds = Since(start);
+    auto sets = static_cast<double>(rounds * count * KeysCount);
+    ::printf("%s: set() %.1f ns, %.2f allocations per set\n", mode, setSeconds * 1e9 / sets,
+             static_cast<double>(allocations - before) / sets);
+
+    size_t total = 0;
+    start = std::chrono::steady_clock::now();
+    for (auto& profile : profiles)
+    {
+        for (size_t i = 0; i < KeysCount; i++)
+        {
+            total += profile->getView(static_cast<STR>(i)).size();
+        }
+    }
+    ::printf("%s: iterate %.2f ns per string (%zu chars)\n", mode,
+             Since(start) * 1e9 / static_cast<double>(count * KeysCount), total);
+
+    easyprofile::VectorWriter writer;
+    start = std::chrono::steady_clock::now();
+    for (auto& profile : profiles)
+    {
+        writer.clear();
+        profile->save(writer);
+    }
+    ::printf("%s: save() %.1f us per profile\n", mode, Since(start) * 1e6 / static_cast<double>(count));
+
+    return 0;
+}
@@ -88,7 +88,7 @@ namespace profile
             assert(it == m_listeners.end());
 #endif
             m_listeners.push_back(listener);
-            ::printf("Profile Listener '%s' added, total: %zu.\n", listener->getName(), m_listeners.size());
+            logListenerAdded(listener, m_listeners.size());
         }
 
         void unsubscribe(Listener* listener)
@@ -97,7 +97,7 @@ namespace profile
             if (it != m_listeners.end())
             {
                 m_listeners.erase(it);
-                ::printf("Profile Listener '%s' removed, remain: %zu.\n", listener->getName(), m_listeners.size());
+                logListenerRemoved(listener, m_listeners.size());
             }
         }
 
@@ -159,6 +159,17 @@ namespace profile
 #undef PROFILE_TYPE
 
     protected:
+        // Called by subscribe() and unsubscribe(), override to silence or redirect the log.
+        virtual void logListenerAdded(const Listener* listener, size_t totalListeners) const
+        {
+            ::printf("Profile Listener '%s' added, total: %zu.\n", listener->getName(), totalListeners);
+        }
+
+        virtual void logListenerRemoved(const Listener* listener, size_t totalListeners) const
+        {
+            ::printf("Profile Listener '%s' removed, remain: %zu.\n", listener->getName(), totalListeners);
+        }
+
         explicit Profile() = default;
 
         explicit Profile(
@@ -94,7 +94,7 @@ namespace profile
             assert(it == m_listeners.end());
 #endif
             m_listeners.push_back(listener);
-            ::printf("Profile Listener '%s' added, total: %zu.\n", listener->getName(), m_listeners.size());
+            logListenerAdded(listener, m_listeners.size());
         }
 
         void unsubscribe(Listener* listener)
@@ -103,7 +103,7 @@ namespace profile
             if (it != m_listeners.end())
             {
                 m_listeners.erase(it);
-                ::printf("Profile Listener '%s' removed, remain: %zu.\n", listener->getName(), m_listeners.size());
+                logListenerRemoved(listener, m_listeners.size());
             }
         }
 
@@ -174,6 +174,17 @@ namespace profile
         }
 
     protected:
+        // Called by subscribe() and unsubscribe(), override to silence or redirect the log.
+        virtual void logListenerAdded(const Listener* listener, size_t totalListeners) const
+        {
+            ::printf("Profile Listener '%s' added, total: %zu.\n", listener->getName(), totalListeners);
+        }
+
+        virtual void logListenerRemoved(const Listener* listener, size_t totalListeners) const
+        {
+            ::printf("Profile Listener '%s' removed, remain: %zu.\n", listener->getName(), totalListeners);
+        }
+
         explicit Profile() = default;
 
         explicit Profile(const Container& container)
@@ -1,35 +1,38 @@
+#include "EasyProfileKeys.h"
+
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <span>
 #include <string>
+#include <thread>
 #include <vector>
 
 // -------------------------------------------------------------------------
 // Application Profile Values
 // -------------------------------------------------------------------------
 
-enum class BOOL
-{
-    ValueOne,
-    ValueTwo,
+#define BOOL_KEYS(KEY) \
+    KEY(ValueOne)      \
+    KEY(ValueTwo)
 
-    Count
-};
+#define U32_KEYS(KEY) \
+    KEY(ValueOne)     \
+    KEY(ValueTwo)
 
-enum class U32
-{
-    ValueOne,
-    ValueTwo,
+#define STR_KEYS(KEY) \
+    KEY(ValueOne)     \
+    KEY(ValueTwo)
 
-    Count
-};
-
-enum class STR
-{
-    ValueOne,
-    ValueTwo,
-
-    Count
-};
+PROFILE_ENUM(BOOL, BOOL_KEYS)
+PROFILE_ENUM(U32, U32_KEYS)
+PROFILE_ENUM(STR, STR_KEYS)
 
 #define PROFILE_TYPES                                                 \
     PROFILE_TYPE(BOOL, Bool, bool, static_cast<size_t>(BOOL::Count))  \
@@ -37,26 +40,34 @@ enum class STR
     PROFILE_TYPE(STR, Str, std::string, static_cast<size_t>(STR::Count))
 
 #include "EasyProfile.h"
+#include "EasyProfileJournal.h"
+#include "EasyProfilePersistence.h"
 
 // -------------------------------------------------------------------------
 // Default Profile Values
 // -------------------------------------------------------------------------
 
-std::array<bool, 2> defaultBool = {
+constexpr std::array<bool, 2> defaultBool = {
     true,
     false
 };
 
-std::array<uint32_t, 2> defaultU32{
+constexpr std::array<uint32_t, 2> defaultU32{
     123u,
     456u
 };
 
-std::array<std::string, 2> defaultStr{
+const std::array<std::string, 2> defaultStr{
     std::string{ "StrOne" },
     std::string{ "StrTwo" }
 };
 
+// Shared by every MyProfile, trivially copyable values are readable at compile time.
+constexpr easyprofile::Profile::Defaults defaults(defaultBool, defaultU32, defaultStr);
+
+static_assert(defaults.get(BOOL::ValueOne) == true);
+static_assert(defaults.get(U32::ValueTwo) == 456u);
+
 // -------------------------------------------------------------------------
 // Small Utility
 // -------------------------------------------------------------------------
@@ -80,7 +91,7 @@ std::string ToTitle(easyprofile::Profile* profile, const char* name, Enum e)
 {
     std::string title = name;
     title += ": ";
-    // title += profile->getName(e);
+    title += profile->getName(e);
     return title;
 }
 
@@ -93,7 +104,7 @@ class MyProfile : public easyprofile::Profile
 public:
     // Setup profile with default values.
     MyProfile()
-        : easyprofile::Profile(defaultBool, defaultU32, defaultStr)
+        : easyprofile::Profile(defaults)
     {
     }
 
@@ -117,6 +128,9 @@ public:
         {
             set(static_cast<STR>(i), std::string("Value ") + std::to_string(i), notifyListeners);
         }
+
+        // Values just read from storage are already persisted.
+        resetDirty();
     }
 
     void dump(const char* title) const
@@ -126,22 +140,22 @@ public:
         for (size_t i = 0; i < static_cast<size_t>(BOOL::Count); i++)
         {
             auto value = get(static_cast<BOOL>(i));
-            auto name = ""; // getName(static_cast<BOOL>(i));
-            ::printf("BOOL[%s] = %s\n", name, value ? "true" : "false");
+            auto name = getName(static_cast<BOOL>(i));
+            ::printf("BOOL[%.*s] = %s\n", static_cast<int>(name.size()), name.data(), value ? "true" : "false");
         }
 
         for (size_t i = 0; i < static_cast<size_t>(U32::Count); i++)
         {
             auto value = get(static_cast<U32>(i));
-            auto name = ""; // getName(static_cast<U32>(i));
-            ::printf("U32[%s] = %u\n", name, value);
+            auto name = getName(static_cast<U32>(i));
+            ::printf("U32[%.*s] = %u\n", static_cast<int>(name.size()), name.data(), value);
         }
 
         for (size_t i = 0; i < static_cast<size_t>(STR::Count); i++)
         {
             auto value = get(static_cast<STR>(i));
-            auto name = ""; // getName(static_cast<STR>(i));
-            ::printf("STR[%s] = %s\n", name, value.c_str());
+            auto name = getName(static_cast<STR>(i));
+            ::printf("STR[%.*s] = %s\n", static_cast<int>(name.size()), name.data(), value.c_str());
         }
     }
 
@@ -157,6 +171,11 @@ private:
     }
 };
 
+// Profile without defaults, every value starts value-initialized.
+class EmptyProfile final : public easyprofile::Profile
+{
+};
+
 // -------------------------------------------------------------------------
 // Application Listeners
 // -------------------------------------------------------------------------
@@ -196,6 +215,12 @@ public:
     {
     }
 
+    void onProfileBatch(std::span<const easyprofile::Profile::Key> keys)
+    {
+        ::printf("%s: batch of %zu key(s)\n", getName(), keys.size());
+        easyprofile::Profile::Listener::onProfileBatch(keys);
+    }
+
     void onProfile(BOOL e, const bool& value)
     {
         auto title = ToTitle(getProfile(), getName(), e);
@@ -215,6 +240,495 @@ public:
     }
 };
 
+class Listener3 final : public easyprofile::Profile::Listener
+{
+public:
+    Listener3(easyprofile::Profile* profile)
+        : easyprofile::Profile::Listener(profile, "Listener3", Subscription::SelectedKeys)
+    {
+        profile->subscribe(this, U32::ValueTwo);
+    }
+
+    void onProfile(U32 e, const uint32_t& value)
+    {
+        auto title = ToTitle(getProfile(), getName(), e);
+        ::printf("%s = %u\n", title.c_str(), value);
+    }
+};
+
+// Registered only for STR changes, BOOL and U32 writes skip it entirely.
+class Listener4 final : public easyprofile::Profile::ListenerT<Listener4>
+{
+public:
+    Listener4(easyprofile::Profile* profile)
+        : easyprofile::Profile::ListenerT<Listener4>(profile, "Listener4")
+    {
+    }
+
+    void onProfile(STR e, const std::string& value)
+    {
+        auto title = ToTitle(getProfile(), getName(), e);
+        ::printf("%s = %s\n", title.c_str(), value.c_str());
+    }
+};
+
+// -------------------------------------------------------------------------
+// Listener Churn Stress Test
+// -------------------------------------------------------------------------
+
+// Listeners add and destroy listeners, themselves included, from inside onProfile().
+// Run a debug build (AddressSanitizer enabled) to catch any use-after-free.
+
+class ChurnListener;
+
+class ChurnProfile final : public easyprofile::Profile
+{
+public:
+    ChurnProfile()
+        : easyprofile::Profile(defaultBool, defaultU32, defaultStr)
+    {
+    }
+};
+
+struct ChurnPool
+{
+    ChurnProfile profile;
+    std::vector<std::unique_ptr<ChurnListener>> listeners;
+    uint32_t seed = 2463534242u;
+    size_t calls = 0;
+    size_t alive = 0;
+
+    uint32_t random()
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    void add();
+
+    void removeRandom()
+    {
+        if (!listeners.empty())
+        {
+            listeners[random() % listeners.size()].reset();
+        }
+    }
+};
+
+class ChurnListener final : public easyprofile::Profile::Listener
+{
+public:
+    ChurnListener(ChurnPool* pool, size_t index, Subscription subscription)
+        : easyprofile::Profile::Listener(&pool->profile, "ChurnListener", subscription)
+        , m_pool(pool)
+        , m_index(index)
+    {
+        pool->alive++;
+        if (subscription == Subscription::SelectedKeys)
+        {
+            pool->profile.subscribe(this, static_cast<U32>(pool->random() % static_cast<uint32_t>(U32::Count)));
+        }
+    }
+
+    ~ChurnListener() override
+    {
+        m_pool->alive--;
+    }
+
+    void onProfile(U32 e, const uint32_t& value) override
+    {
+        (void)e;
+        (void)value;
+
+        // Members are not touched after this listener may have been destroyed.
+        auto* pool = m_pool;
+        auto index = m_index;
+
+        pool->calls++;
+        switch (pool->random() % 4)
+        {
+        case 0:
+            pool->listeners[index].reset();
+            break;
+
+        case 1:
+            pool->removeRandom();
+            break;
+
+        case 2:
+            if (pool->alive < 256)
+            {
+                pool->add();
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+private:
+    ChurnPool* m_pool;
+    size_t m_index;
+};
+
+void ChurnPool::add()
+{
+    auto subscription = random() % 2 == 0
+        ? ChurnListener::Subscription::AllKeys
+        : ChurnListener::Subscription::SelectedKeys;
+    auto index = listeners.size();
+    listeners.push_back(nullptr);
+    listeners[index] = std::make_unique<ChurnListener>(this, index, subscription);
+}
+
+void StressListeners()
+{
+    Section section("* Listener Churn Stress Test");
+
+    ChurnPool pool;
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        pool.add();
+    }
+
+    for (uint32_t i = 0; i < 10000; i++)
+    {
+        auto key = static_cast<U32>(pool.random() % static_cast<uint32_t>(U32::Count));
+        switch (pool.random() % 4)
+        {
+        case 0:
+            if (pool.alive < 256)
+            {
+                pool.add();
+            }
+            break;
+
+        case 1:
+            pool.removeRandom();
+            break;
+
+        case 2:
+        {
+            easyprofile::Profile::Batch batch(pool.profile);
+            pool.profile.set(key, i);
+            pool.profile.set(U32::ValueOne, i + 1);
+            break;
+        }
+
+        default:
+            pool.profile.set(key, i);
+            break;
+        }
+    }
+
+    ::printf("Notifications: %zu, listeners alive: %zu\n", pool.calls, pool.alive);
+    pool.listeners.clear();
+}
+
+// -------------------------------------------------------------------------
+// Nested Flush Test
+// -------------------------------------------------------------------------
+
+// A listener commits a batch of its own while the outer batch is dispatched. Both
+// levels must deliver their keys, and once warmed up neither may allocate.
+
+// Journal compactions allocate on their own thread.
+std::atomic<size_t> allocations = 0;
+
+void* Allocate(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto* ptr = ::malloc(size != 0 ? size : 1))
+    {
+        return ptr;
+    }
+    ::abort();
+}
+
+void Free(void* ptr)
+{
+    ::free(ptr);
+}
+
+void* operator new(size_t size)
+{
+    return Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    Free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    Free(ptr);
+}
+
+class NestedListener final : public easyprofile::Profile::Listener
+{
+public:
+    NestedListener(easyprofile::Profile* profile)
+        : easyprofile::Profile::Listener(profile, "NestedListener")
+        , m_profile(profile)
+    {
+    }
+
+    void onProfileBatch(std::span<const easyprofile::Profile::Key> keys) override
+    {
+        batches++;
+        notified += keys.size();
+        if (keys.front() == easyprofile::Profile::makeKey(U32::ValueOne))
+        {
+            easyprofile::Profile::Batch batch(*m_profile);
+            m_profile->set(U32::ValueTwo, m_profile->get(U32::ValueOne) + 1);
+            m_profile->set(BOOL::ValueOne, !m_profile->get(BOOL::ValueOne));
+        }
+    }
+
+    size_t batches = 0;
+    size_t notified = 0;
+
+private:
+    easyprofile::Profile* m_profile;
+};
+
+void NestedFlush()
+{
+    Section section("* Nested Flush Test");
+
+    ChurnProfile profile;
+    NestedListener listener(&profile);
+
+    auto round = [&profile](uint32_t i) {
+        easyprofile::Profile::Batch batch(profile);
+        profile.set(U32::ValueOne, i);
+        profile.set(BOOL::ValueTwo, i % 2 == 0);
+    };
+
+    round(1000u);
+    auto before = allocations.load();
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        round(i);
+    }
+
+    ::printf("Batches: %zu, keys: %zu, allocations after warm-up: %zu\n",
+             listener.batches, listener.notified, allocations.load() - before);
+}
+
+// -------------------------------------------------------------------------
+// Journal Crash Test
+// -------------------------------------------------------------------------
+
+// Cuts the journal at random offsets, as a crash in the middle of a write would,
+// and checks that every recovery yields a state the profile actually had.
+
+std::vector<std::byte> ReadFile(const char* path)
+{
+    std::vector<std::byte> bytes;
+    if (auto* file = ::fopen(path, "rb"))
+    {
+        std::byte buffer[4096];
+        size_t size;
+        while ((size = ::fread(buffer, 1, sizeof(buffer), file)) != 0)
+        {
+            bytes.insert(bytes.end(), buffer, buffer + size);
+        }
+        ::fclose(file);
+    }
+    return bytes;
+}
+
+void WriteFile(const char* path, std::span<const std::byte> bytes)
+{
+    if (auto* file = ::fopen(path, "wb"))
+    {
+        ::fwrite(bytes.data(), 1, bytes.size(), file);
+        ::fclose(file);
+    }
+}
+
+std::vector<std::byte> Fingerprint(const easyprofile::Profile& profile)
+{
+    easyprofile::VectorWriter writer;
+    profile.save(writer);
+    return writer.data();
+}
+
+void JournalCrashTest()
+{
+    Section section("* Journal Crash Test");
+
+    const char* basePath = "easy-profile-test";
+    const char* snapshotPath = "easy-profile-test.snap";
+    const char* logPath = "easy-profile-test.log";
+    ::remove(snapshotPath);
+    ::remove(logPath);
+
+    ChurnPool pool;
+    auto& profile = pool.profile;
+    std::vector<std::vector<std::byte>> states{ Fingerprint(profile) };
+    {
+        easyprofile::Journal journal(basePath, 512);
+        journal.open(profile);
+
+        for (uint32_t i = 0; i < 200; i++)
+        {
+            for (uint32_t n = pool.random() % 3; n < 3; n++)
+            {
+                auto value = pool.random();
+                switch (value % 3)
+                {
+                case 0:
+                    profile.set(static_cast<BOOL>(value % 2), (value & 4) != 0, false);
+                    break;
+                case 1:
+                    profile.set(static_cast<U32>(value % 2), value, false);
+                    break;
+                default:
+                    profile.set(static_cast<STR>(value % 2), std::string(value % 17, 'a' + value % 26), false);
+                    break;
+                }
+            }
+            journal.append(profile);
+            states.push_back(Fingerprint(profile));
+        }
+    }
+
+    auto snapshot = ReadFile(snapshotPath);
+    auto log = ReadFile(logPath);
+
+    size_t recovered = 0;
+    const size_t attempts = 200;
+    for (size_t i = 0; i < attempts; i++)
+    {
+        WriteFile(snapshotPath, snapshot);
+        WriteFile(logPath, std::span{ log }.first(pool.random() % (log.size() + 1)));
+
+        ChurnProfile restored;
+        easyprofile::Journal journal(basePath);
+        journal.open(restored);
+
+        auto state = Fingerprint(restored);
+        if (std::find(states.begin(), states.end(), state) != states.end())
+        {
+            recovered++;
+        }
+    }
+
+    ::printf("Snapshot: %zu bytes, log: %zu bytes.\n", snapshot.size(), log.size());
+    ::printf("Consistent recoveries: %zu of %zu.\n", recovered, attempts);
+
+    ::remove(snapshotPath);
+    ::remove(logPath);
+}
+
+// Takes the files as a crash right after the snapshot is written, before the log is cut,
+// leaves them: the whole log replays over the new snapshot. The recovered state must be
+// the last one appended.
+void CompactionCrashTest()
+{
+    Section section("* Compaction Crash Test");
+
+    const char* basePath = "easy-profile-compaction";
+    const char* snapshotPath = "easy-profile-compaction.snap";
+    const char* logPath = "easy-profile-compaction.log";
+    ::remove(snapshotPath);
+    ::remove(logPath);
+
+    ChurnProfile profile;
+    std::vector<std::byte> appended;
+    std::vector<std::byte> snapshot;
+    std::vector<std::byte> log;
+    {
+        easyprofile::Journal journal(basePath);
+        journal.open(profile);
+
+        profile.set(U32::ValueOne, 1u, false);
+        journal.append(profile);
+        appended = Fingerprint(profile);
+
+        // Not in the log yet, a snapshot of these would be overwritten by the record above.
+        profile.set(U32::ValueOne, 2u, false);
+        profile.set(U32::ValueTwo, 7u, false);
+        auto started = journal.compact(profile);
+        ::printf("Compaction of a dirty profile %s.\n", started ? "started" : "skipped");
+
+        if (!started)
+        {
+            journal.append(profile);
+            appended = Fingerprint(profile);
+            journal.compact(profile);
+        }
+        while ((snapshot = ReadFile(snapshotPath)).empty())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        log = ReadFile(logPath);
+        journal.waitCompaction();
+    }
+
+    WriteFile(snapshotPath, snapshot);
+    WriteFile(logPath, log);
+
+    ChurnProfile restored;
+    easyprofile::Journal journal(basePath);
+    journal.open(restored);
+    ::printf("Recovered U32::ValueOne = %u, U32::ValueTwo = %u (%s).\n",
+             restored.get(U32::ValueOne), restored.get(U32::ValueTwo),
+             Fingerprint(restored) == appended ? "consistent" : "inconsistent");
+
+    ::remove(snapshotPath);
+    ::remove(logPath);
+}
+
+void BackgroundPersistence()
+{
+    Section section("* Background Persistence");
+
+    const char* basePath = "easy-profile-worker";
+    const char* snapshotPath = "easy-profile-worker.snap";
+    const char* logPath = "easy-profile-worker.log";
+    ::remove(snapshotPath);
+    ::remove(logPath);
+
+    {
+        ChurnProfile profile;
+        easyprofile::Journal journal(basePath);
+        journal.open(profile);
+        easyprofile::PersistenceWorker worker(profile, journal, std::chrono::milliseconds(20));
+
+        // A burst of sets, then frames until it's written.
+        for (uint32_t i = 0; i < 100; i++)
+        {
+            profile.set(U32::ValueOne, i);
+            worker.update();
+        }
+        while (profile.isDirty() || worker.getWritesCount() == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            worker.update();
+        }
+        ::printf("Burst of 100 sets written in %zu write(s).\n", worker.getWritesCount());
+
+        profile.set(STR::ValueTwo, std::string{ "Persisted" });
+        ::printf("Flush %s.\n", worker.flush() ? "succeeded" : "failed");
+    }
+
+    ChurnProfile restored;
+    easyprofile::Journal journal(basePath);
+    journal.open(restored);
+    ::printf("Restored U32::ValueOne = %u, STR::ValueTwo = %s\n",
+             restored.get(U32::ValueOne), restored.get(STR::ValueTwo).c_str());
+
+    ::remove(snapshotPath);
+    ::remove(logPath);
+}
+
 // -------------------------------------------------------------------------
 // Application Entry Point
 // -------------------------------------------------------------------------
@@ -229,6 +743,8 @@ int main()
 
     Listener1 listener1(&profile);
     Listener2 listener2(&profile);
+    Listener3 listener3(&profile);
+    Listener4 listener4(&profile);
 
     ::printf("\n");
 
@@ -242,6 +758,48 @@ int main()
         profile.set(BOOL::ValueOne, false);
         profile.set(U32::ValueTwo, 789u);
         profile.set(STR::ValueOne, std::string{ "NewStringOne" });
+        profile.emplace(STR::ValueTwo, 3u, 'x');
+        profile.modify(U32::ValueOne, [](uint32_t& value) {
+            value += 5u;
+        });
+        profile.modify(STR::ValueTwo, [](std::string& value) {
+            value += "yz";
+            return true;
+        });
+    }
+
+    {
+        Section section("* Batch Update Profile Values");
+        easyprofile::Profile::Batch batch(profile);
+        profile.set(U32::ValueOne, 1u);
+        profile.set(U32::ValueOne, 2u);
+        profile.set(STR::ValueTwo, std::string{ "BatchString" });
+    }
+
+    {
+        Section section("* Batch Set And Restore");
+        easyprofile::Profile::Batch batch(profile);
+        auto original = profile.get(U32::ValueTwo);
+        profile.set(U32::ValueTwo, original + 1);
+        profile.set(U32::ValueTwo, original);
+        profile.modify(STR::ValueTwo, [](std::string& value) {
+            value += "!";
+        });
+        profile.modify(STR::ValueTwo, [](std::string& value) {
+            value.pop_back();
+        });
+        profile.set(BOOL::ValueTwo, !profile.get(BOOL::ValueTwo));
+        ::printf("Only BOOL::ValueTwo changed\n");
+    }
+
+    {
+        Section section("* Deferred Update Profile Values");
+        profile.setDeferred(true);
+        profile.set(BOOL::ValueTwo, false);
+        profile.set(U32::ValueTwo, 1000u);
+        ::printf("Pending until pump()\n");
+        profile.pump();
+        profile.setDeferred(false);
     }
 
     {
@@ -253,5 +811,149 @@ int main()
 
     profile.dump("* Updated Values");
 
+    {
+        easyprofile::VectorWriter writer;
+        profile.save(writer);
+
+        MyProfile restored;
+        auto loaded = restored.load(writer.data());
+        ::printf("Snapshot of %zu bytes %s.\n\n", writer.data().size(), loaded ? "loaded" : "rejected");
+        restored.dump("* Restored Values");
+
+        auto truncated = std::span{ writer.data() }.first(writer.data().size() / 2);
+        ::printf("Truncated snapshot %s.\n\n", restored.load(truncated) ? "loaded" : "rejected");
+
+        // The first value of the BOOL section, right after the file and section headers.
+        auto corrupted = writer.data();
+        corrupted[sizeof(easyprofile::snapshot::FileHeader) + sizeof(easyprofile::snapshot::SectionHeader)] = std::byte{ 2 };
+        ::printf("Snapshot with an invalid bool %s.\n\n", restored.load(corrupted) ? "loaded" : "rejected");
+    }
+
+    {
+        Section section("* Snapshot Value Kinds");
+        namespace snapshot = easyprofile::snapshot;
+        const std::array<int32_t, 2> values{ 1, -1 };
+
+        // Same size, different kind: int32_t values must not be read back as float.
+        easyprofile::VectorWriter writer;
+        snapshot::writeFileHeader(writer, 1u);
+        snapshot::writeSection(writer, 0u, values, values.size());
+        std::array<snapshot::Section, 1> sections;
+        snapshot::parse(writer.data(), sections, [](uint64_t) {
+            return size_t{ 0 };
+        });
+        ::printf("int32_t section as int32_t: %s, as float: %s\n",
+                 snapshot::compatible<int32_t>(sections[0]) ? "loaded" : "rejected",
+                 snapshot::compatible<float>(sections[0]) ? "loaded" : "rejected");
+
+        writer.clear();
+        snapshot::writeEntry<int32_t>(writer, 0u, 1u, values[1]);
+        snapshot::parseEntries(writer.data(), [](const snapshot::Entry& entry) {
+            ::printf("int32_t entry as int32_t: %s, as float: %s\n",
+                     snapshot::compatible<int32_t>(entry) ? "loaded" : "rejected",
+                     snapshot::compatible<float>(entry) ? "loaded" : "rejected");
+            return true;
+        });
+    }
+
+    {
+        Section section("* Find Keys By Name");
+        static_assert(easyprofile::Profile::getName(U32::ValueTwo) == "ValueTwo");
+        static_assert(easyprofile::Profile::findKey<U32>("ValueOne") == U32::ValueOne);
+
+        for (const char* name : { "ValueTwo", "ValueThree" })
+        {
+            if (auto key = profile.findKey<U32>(name))
+            {
+                ::printf("U32[%s] = %u\n", name, profile.get(*key));
+            }
+            else
+            {
+                ::printf("U32[%s] not found\n", name);
+            }
+        }
+    }
+
+    StressListeners();
+    NestedFlush();
+    JournalCrashTest();
+    CompactionCrashTest();
+    BackgroundPersistence();
+
+    {
+        Section section("* Dirty Keys");
+        profile.forEachDirty<BOOL>([](BOOL e) {
+            ::printf("BOOL[%u] is dirty\n", static_cast<uint32_t>(e));
+        });
+        profile.forEachDirty<U32>([](U32 e) {
+            ::printf("U32[%u] is dirty\n", static_cast<uint32_t>(e));
+        });
+
+        std::vector<STR> dirtyStr;
+        profile.collectDirty(dirtyStr);
+        for (auto e : dirtyStr)
+        {
+            ::printf("STR[%u] is dirty\n", static_cast<uint32_t>(e));
+        }
+
+        profile.resetDirty();
+    }
+
+    {
+        Section section("* Reset To Defaults");
+        auto countNonDefault = [&profile] {
+            size_t count = 0;
+            profile.forEachNonDefault([&count](auto, const auto&) {
+                count++;
+            });
+            return count;
+        };
+
+        profile.forEachNonDefault<U32>([](U32 e, uint32_t value) {
+            ::printf("U32[%u] = %u differs from default\n", static_cast<uint32_t>(e), value);
+        });
+
+        easyprofile::VectorWriter nonDefault;
+        profile.saveNonDefault(nonDefault);
+        auto before = countNonDefault();
+
+        profile.reset(U32::ValueOne);
+        ::printf("After reset(U32::ValueOne): U32::ValueOne = %u\n", profile.get(U32::ValueOne));
+
+        profile.resetAll(false);
+        ::printf("After resetAll(): %zu non-default keys\n", countNonDefault());
+
+        profile.init(defaults);
+        profile.loadDirty(nonDefault.data());
+        ::printf("Restored %zu of %zu non-default keys from %zu bytes\n", countNonDefault(), before, nonDefault.data().size());
+        profile.resetDirty();
+    }
+
+    {
+        Section section("* Bulk Set");
+        const std::array<uint32_t, 2> imported{ 777u, 888u };
+        auto changed = profile.setRange(U32::ValueOne, imported);
+        ::printf("setRange() changed %zu keys, again: %zu\n", changed, profile.setRange(U32::ValueOne, imported));
+
+        for (auto value : profile.getSpan<U32>())
+        {
+            ::printf("U32 = %u\n", value);
+        }
+        profile.resetDirty();
+    }
+
+    {
+        Section section("* Default Constructed Profile");
+        EmptyProfile empty;
+        ::printf("U32::ValueOne = %u, STR::ValueOne = '%s'\n", empty.get(U32::ValueOne), empty.get(STR::ValueOne).c_str());
+
+        empty.set(U32::ValueOne, 42u);
+        empty.set(STR::ValueOne, std::string{ "Set" });
+        ::printf("After set(): U32::ValueOne = %u, STR::ValueOne = '%s'\n", empty.get(U32::ValueOne), empty.get(STR::ValueOne).c_str());
+
+        empty.resetAll(false);
+        ::printf("After resetAll(): U32::ValueOne = %u, dirty: %s\n", empty.get(U32::ValueOne), empty.isDirty() ? "yes" : "no");
+    }
+
     return 0;
 }